@@ -0,0 +1,100 @@
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "gl_extensions.hpp"
+#include "gl_mock.hpp"
+#include "particle_generator.hpp"
+#include "shader.hpp"
+#include "sprite_batch.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+// Builds the instance buffers for a synthetic scene of a million sprites and a million particles, three quarters of
+// them alive, with thread pools of 1 to N threads and reports the time per frame and the speedup over one thread. A
+// frame counts everything from queueing the sprites and finding the live particles to the filled buffers. Runs
+// against GLMock, whose mapped buffers are ordinary memory; a driver's write-combined mappings may scale differently.
+//
+//     batch_threads_bench [sprites] [frames] [max threads]
+
+const char* vertexSource { "#version 330 core\nvoid main() { }\n" };
+const char* fragmentSource { "#version 330 core\nvoid main() { }\n" };
+
+int main(int argc, char** argv)
+{
+    size_t count { argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000000 };
+    size_t frames { argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 20 };
+    size_t maxThreads { argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 1u) };
+
+    if (!GLMock::get().load()) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return EXIT_FAILURE;
+    }
+    GLExtensions::get().load(&GLMock::getProcAddress);
+
+    Shader shader;
+    shader.compile(vertexSource, fragmentSource);
+    Texture2D texture;
+    texture.generate(1, 1, nullptr);
+
+    // sprites already in key order, a few long runs of the same texture like a big level
+    std::mt19937 random { 42 };
+    std::uniform_real_distribution<float> unit { 0.0f, 1.0f };
+    std::vector<std::pair<GLuint, SpriteDraw>> sprites(count);
+    for (size_t i { 0 }; i < count; ++i) {
+        sprites[i].first = 1 + i * 16 / count;
+        sprites[i].second = SpriteDraw { glm::vec2(unit(random) * 800.0f, unit(random) * 600.0f), glm::vec2(40.0f, 20.0f),
+            glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec3(unit(random), unit(random), unit(random)), unit(random) * 360.0f };
+    }
+
+    SpriteBatch batch { shader, count };
+    ParticleGenerator generator { shader, texture, count };
+    GameObject emitter { glm::vec2(400.0f, 300.0f), glm::vec2(10.0f), texture, glm::vec3(1.0f), glm::vec2(50.0f, 20.0f) };
+    generator.update(0.0f, emitter, count * 3 / 4);
+
+    std::cout << count << " sprites and particles, " << frames << " frames" << std::endl;
+    double baseSprites { 0.0 }, baseParticles { 0.0 };
+
+    for (size_t threads { 1 }; threads <= maxThreads; threads = threads < 4 ? threads + 1 : threads * 2) {
+        ThreadPool pool { threads };
+        batch.setThreadPool(&pool);
+        generator.setThreadPool(&pool);
+        double spriteSeconds { 0.0 }, particleSeconds { 0.0 };
+
+        // the first frame grows the buffers, it isn't counted
+        for (size_t frame { 0 }; frame <= frames; ++frame) {
+            auto start { std::chrono::steady_clock::now() };
+            batch.begin();
+            for (const auto& sprite : sprites)
+                batch.drawSprite(sprite.first, sprite.second);
+            batch.end();
+            auto middle { std::chrono::steady_clock::now() };
+            generator.draw();
+            auto stop { std::chrono::steady_clock::now() };
+
+            if (frame > 0) {
+                spriteSeconds += std::chrono::duration<double>(middle - start).count();
+                particleSeconds += std::chrono::duration<double>(stop - middle).count();
+            }
+        }
+
+        if (threads == 1) {
+            baseSprites = spriteSeconds;
+            baseParticles = particleSeconds;
+        }
+        std::cout << "  " << threads << " threads: sprites " << spriteSeconds * 1e3 / frames << " ms (" << baseSprites / spriteSeconds
+                  << "x), particles " << particleSeconds * 1e3 / frames << " ms (" << baseParticles / particleSeconds << "x)" << std::endl;
+    }
+
+    batch.setThreadPool(nullptr);
+    generator.setThreadPool(nullptr);
+    texture.deleteTexture();
+    shader.deleteShader();
+    return EXIT_SUCCESS;
+}
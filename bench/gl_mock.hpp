@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+
+// X(return type, name, parameters, body) for every GL function the engine calls. Parameters the body doesn't use
+// are left unnamed. Anything missing here stays null in glad, so a new call in the engine crashes the benchmark
+// right where it has to be added.
+#define GL_MOCK_FUNCTIONS(X)                                                                                        \
+    X(void, glActiveTexture, (GLenum), )                                                                            \
+    X(void, glAttachShader, (GLuint, GLuint), )                                                                     \
+    X(void, glBindBuffer, (GLenum target, GLuint buffer), mock.m_boundBuffers[target] = buffer;)                    \
+    X(void, glBindBufferBase, (GLenum target, GLuint, GLuint buffer), mock.m_boundBuffers[target] = buffer;)        \
+    X(void, glBindFramebuffer, (GLenum target, GLuint framebuffer), mock.bindFramebuffer(target, framebuffer);)     \
+    X(void, glBindRenderbuffer, (GLenum, GLuint), )                                                                 \
+    X(void, glBindTexture, (GLenum, GLuint), )                                                                      \
+    X(void, glBindVertexArray, (GLuint), )                                                                          \
+    X(void, glBlendFunc, (GLenum, GLenum), )                                                                        \
+    X(void, glBlitFramebuffer, (GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLint, GLbitfield, GLenum), )      \
+    X(void, glBufferData, (GLenum target, GLsizeiptr size, const void* data, GLenum),                               \
+        mock.bufferData(target, size, data);)                                                                       \
+    X(void, glBufferSubData, (GLenum, GLintptr, GLsizeiptr size, const void*), mock.m_uploaded += size;)            \
+    X(GLenum, glCheckFramebufferStatus, (GLenum), return GL_FRAMEBUFFER_COMPLETE;)                                  \
+    X(void, glClear, (GLbitfield), )                                                                                \
+    X(void, glClearColor, (GLfloat, GLfloat, GLfloat, GLfloat), )                                                   \
+    X(GLenum, glClientWaitSync, (GLsync, GLbitfield, GLuint64), return GL_ALREADY_SIGNALED;)                        \
+    X(void, glCompileShader, (GLuint), )                                                                            \
+    X(GLuint, glCreateProgram, (), return mock.create(ProgramObject);)                                              \
+    X(GLuint, glCreateShader, (GLenum), return mock.create(ShaderObject);)                                          \
+    X(void, glDeleteBuffers, (GLsizei n, const GLuint* buffers), mock.destroy(BufferObject, n, buffers);)           \
+    X(void, glDeleteFramebuffers, (GLsizei n, const GLuint* names), mock.destroy(FramebufferObject, n, names);)     \
+    X(void, glDeleteProgram, (GLuint program), mock.destroy(ProgramObject, 1, &program);)                           \
+    X(void, glDeleteQueries, (GLsizei n, const GLuint* names), mock.destroy(QueryObject, n, names);)                \
+    X(void, glDeleteRenderbuffers, (GLsizei n, const GLuint* names), mock.destroy(RenderbufferObject, n, names);)   \
+    X(void, glDeleteShader, (GLuint shader), mock.destroy(ShaderObject, 1, &shader);)                               \
+    X(void, glDeleteSync, (GLsync sync), mock.destroySync(sync);)                                                   \
+    X(void, glDeleteTextures, (GLsizei n, const GLuint* names), mock.destroy(TextureObject, n, names);)             \
+    X(void, glDeleteVertexArrays, (GLsizei n, const GLuint* names), mock.destroy(VertexArrayObject, n, names);)     \
+    X(void, glDisable, (GLenum), )                                                                                  \
+    X(void, glDrawArrays, (GLenum, GLint, GLsizei), )                                                               \
+    X(void, glDrawArraysInstanced, (GLenum, GLint, GLsizei, GLsizei), )                                             \
+    X(void, glDrawElements, (GLenum, GLsizei, GLenum, const void*), )                                               \
+    X(void, glEnable, (GLenum), )                                                                                   \
+    X(void, glEnableVertexAttribArray, (GLuint), )                                                                  \
+    X(GLsync, glFenceSync, (GLenum, GLbitfield), return mock.createSync();)                                         \
+    X(void, glFinish, (), )                                                                                         \
+    X(void, glFramebufferRenderbuffer, (GLenum, GLenum, GLenum, GLuint), )                                          \
+    X(void, glFramebufferTexture2D, (GLenum, GLenum, GLenum, GLuint, GLint), )                                      \
+    X(void, glGenBuffers, (GLsizei n, GLuint* names), mock.create(BufferObject, n, names);)                         \
+    X(void, glGenFramebuffers, (GLsizei n, GLuint* names), mock.create(FramebufferObject, n, names);)               \
+    X(void, glGenQueries, (GLsizei n, GLuint* names), mock.create(QueryObject, n, names);)                          \
+    X(void, glGenRenderbuffers, (GLsizei n, GLuint* names), mock.create(RenderbufferObject, n, names);)             \
+    X(void, glGenTextures, (GLsizei n, GLuint* names), mock.create(TextureObject, n, names);)                       \
+    X(void, glGenVertexArrays, (GLsizei n, GLuint* names), mock.create(VertexArrayObject, n, names);)               \
+    X(void, glGenerateMipmap, (GLenum), )                                                                           \
+    X(void, glGetActiveUniform, (GLuint, GLuint, GLsizei, GLsizei*, GLint*, GLenum*, GLchar*), )                    \
+    X(void, glGetBooleanv, (GLenum, GLboolean * data), *data = GL_TRUE;)                                            \
+    X(GLenum, glGetError, (), return GL_NO_ERROR;)                                                                  \
+    X(void, glGetFramebufferAttachmentParameteriv, (GLenum, GLenum, GLenum name, GLint * data),                     \
+        *data = name == GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE ? 0 : 8;)                                              \
+    X(void, glGetIntegerv, (GLenum name, GLint * data), mock.getInteger(name, data);)                               \
+    X(void, glGetProgramInfoLog, (GLuint, GLsizei size, GLsizei*, GLchar* log), if (size > 0) log[0] = '\0';)       \
+    X(void, glGetProgramiv, (GLuint, GLenum name, GLint * data), *data = name == GL_LINK_STATUS;)                   \
+    X(void, glGetQueryObjectiv, (GLuint, GLenum, GLint * data), *data = 1;)                                         \
+    X(void, glGetQueryObjectui64v, (GLuint, GLenum, GLuint64 * data), *data = 0;)                                   \
+    X(void, glGetShaderInfoLog, (GLuint, GLsizei size, GLsizei*, GLchar* log), if (size > 0) log[0] = '\0';)        \
+    X(void, glGetShaderiv, (GLuint, GLenum name, GLint * data), *data = name == GL_COMPILE_STATUS;)                 \
+    X(const GLubyte*, glGetString, (GLenum name), return mock.getString(name);)                                     \
+    X(const GLubyte*, glGetStringi, (GLenum, GLuint), return reinterpret_cast<const GLubyte*>("GL_MOCK_recording");) \
+    X(GLuint, glGetUniformBlockIndex, (GLuint, const GLchar*), return 0;)                                           \
+    X(GLint, glGetUniformLocation, (GLuint program, const GLchar* name), return mock.getUniformLocation(program, name);) \
+    X(void, glLinkProgram, (GLuint), )                                                                              \
+    X(void*, glMapBufferRange, (GLenum target, GLintptr offset, GLsizeiptr size, GLbitfield),                       \
+        return mock.mapBuffer(target, offset, size);)                                                               \
+    X(void, glPixelStorei, (GLenum, GLint), )                                                                       \
+    X(void, glQueryCounter, (GLuint, GLenum), )                                                                     \
+    X(void, glRenderbufferStorageMultisample, (GLenum, GLsizei, GLenum, GLsizei, GLsizei), )                        \
+    X(void, glScissor, (GLint, GLint, GLsizei, GLsizei), )                                                          \
+    X(void, glShaderSource, (GLuint, GLsizei, const GLchar* const*, const GLint*), )                                \
+    X(void, glTexBuffer, (GLenum, GLenum, GLuint), )                                                                \
+    X(void, glTexImage2D, (GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const void*), )           \
+    X(void, glTexImage2DMultisample, (GLenum, GLsizei, GLenum, GLsizei, GLsizei, GLboolean), )                      \
+    X(void, glTexParameteri, (GLenum, GLenum, GLint), )                                                             \
+    X(void, glTexSubImage2D, (GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*), )        \
+    X(void, glUniform1f, (GLint, GLfloat), )                                                                        \
+    X(void, glUniform1fv, (GLint, GLsizei, const GLfloat*), )                                                       \
+    X(void, glUniform1i, (GLint, GLint), )                                                                          \
+    X(void, glUniform1iv, (GLint, GLsizei, const GLint*), )                                                         \
+    X(void, glUniform2fv, (GLint, GLsizei, const GLfloat*), )                                                       \
+    X(void, glUniform3fv, (GLint, GLsizei, const GLfloat*), )                                                       \
+    X(void, glUniform4fv, (GLint, GLsizei, const GLfloat*), )                                                       \
+    X(void, glUniformBlockBinding, (GLuint, GLuint, GLuint), )                                                      \
+    X(void, glUniformMatrix2fv, (GLint, GLsizei, GLboolean, const GLfloat*), )                                      \
+    X(void, glUniformMatrix3fv, (GLint, GLsizei, GLboolean, const GLfloat*), )                                      \
+    X(void, glUniformMatrix4fv, (GLint, GLsizei, GLboolean, const GLfloat*), )                                      \
+    X(GLboolean, glUnmapBuffer, (GLenum), return GL_TRUE;)                                                          \
+    X(void, glUseProgram, (GLuint), )                                                                               \
+    X(void, glVertexAttribDivisor, (GLuint, GLuint), )                                                              \
+    X(void, glVertexAttribPointer, (GLuint, GLint, GLenum, GLboolean, GLsizei, const void*), )                      \
+    X(void, glViewport, (GLint x, GLint y, GLsizei width, GLsizei height), mock.setViewport(x, y, width, height);)
+
+enum GLMockCall {
+#define GL_MOCK_CALL(returnType, name, parameters, ...) name##Call,
+    GL_MOCK_FUNCTIONS(GL_MOCK_CALL)
+#undef GL_MOCK_CALL
+        GLMockCallCount
+};
+
+enum GLMockObject {
+    BufferObject,
+    TextureObject,
+    VertexArrayObject,
+    FramebufferObject,
+    RenderbufferObject,
+    QueryObject,
+    ShaderObject,
+    ProgramObject,
+    SyncObject,
+    GLMockObjectCount
+};
+
+// Stands in for a GL implementation: counts every call by function, keeps track of created and deleted objects
+// and hands out made up names. Buffers get real memory so mapping them works. Nothing is drawn, which leaves
+// only the CPU side of rendering to measure.
+class GLMock {
+public:
+    static GLMock& get()
+    {
+        static GLMock mock;
+        return mock;
+    }
+
+    // points glad and the extension loader at the mock instead of a driver
+    bool load()
+    {
+        return gladLoadGLLoader(&GLMock::getProcAddress);
+    }
+
+    static void* getProcAddress(const char* name)
+    {
+#define GL_MOCK_ADDRESS(returnType, function, parameters, ...)                       \
+    if (std::strcmp(name, #function) == 0)                                        \
+        return reinterpret_cast<void*>(static_cast<returnType(APIENTRYP) parameters>( \
+            [] parameters -> returnType {                                         \
+                GLMock& mock { GLMock::get() };                                   \
+                ++mock.m_calls[function##Call];                                   \
+                __VA_ARGS__                                                       \
+            }));
+        GL_MOCK_FUNCTIONS(GL_MOCK_ADDRESS)
+#undef GL_MOCK_ADDRESS
+        return nullptr;
+    }
+
+    static const char* getCallName(size_t call)
+    {
+        static const char* names[] {
+#define GL_MOCK_NAME(returnType, name, parameters, ...) #name,
+            GL_MOCK_FUNCTIONS(GL_MOCK_NAME)
+#undef GL_MOCK_NAME
+        };
+        return names[call];
+    }
+
+    void resetCounts()
+    {
+        std::fill(std::begin(m_calls), std::end(m_calls), 0);
+        m_uploaded = 0;
+    }
+
+    uint64_t getCount(size_t call) const { return m_calls[call]; }
+
+    uint64_t getTotalCount() const
+    {
+        uint64_t total { 0 };
+        for (uint64_t count : m_calls)
+            total += count;
+        return total;
+    }
+
+    // bytes sent through glBufferData, glBufferSubData and mapped ranges since resetCounts()
+    uint64_t getUploaded() const { return m_uploaded; }
+
+    size_t getCreated(GLMockObject type) const { return m_created[type]; }
+
+    size_t getLive(GLMockObject type) const { return m_created[type] - m_deleted[type]; }
+
+private:
+    uint64_t m_calls[GLMockCallCount] {};
+    uint64_t m_uploaded { 0 };
+    size_t m_created[GLMockObjectCount] {};
+    size_t m_deleted[GLMockObjectCount] {};
+    GLuint m_nextName { 1 };
+    std::map<GLenum, GLuint> m_boundBuffers;
+    std::unordered_map<GLuint, std::vector<char>> m_buffers;
+    std::map<std::pair<GLuint, std::string>, GLint> m_uniformLocations;
+    GLint m_viewport[4] {};
+    GLuint m_drawFramebuffer { 0 };
+
+    GLMock() = default;
+
+    GLuint create(GLMockObject type)
+    {
+        ++m_created[type];
+        return m_nextName++;
+    }
+
+    void create(GLMockObject type, GLsizei n, GLuint* names)
+    {
+        for (GLsizei i { 0 }; i < n; ++i)
+            names[i] = create(type);
+    }
+
+    // deleting 0 is allowed and does nothing, just like in GL
+    void destroy(GLMockObject type, GLsizei n, const GLuint* names)
+    {
+        for (GLsizei i { 0 }; i < n; ++i) {
+            if (names[i] == 0)
+                continue;
+            ++m_deleted[type];
+            if (type == BufferObject)
+                m_buffers.erase(names[i]);
+        }
+    }
+
+    GLsync createSync() { return reinterpret_cast<GLsync>(static_cast<uintptr_t>(create(SyncObject))); }
+
+    void destroySync(GLsync sync)
+    {
+        if (sync)
+            ++m_deleted[SyncObject];
+    }
+
+    void bindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        if (target != GL_READ_FRAMEBUFFER)
+            m_drawFramebuffer = framebuffer;
+    }
+
+    void bufferData(GLenum target, GLsizeiptr size, const void* data)
+    {
+        std::vector<char>& buffer { m_buffers[m_boundBuffers[target]] };
+        buffer.assign(size, 0);
+        if (data) {
+            std::memcpy(buffer.data(), data, size);
+            m_uploaded += size;
+        }
+    }
+
+    void* mapBuffer(GLenum target, GLintptr offset, GLsizeiptr size)
+    {
+        std::vector<char>& buffer { m_buffers[m_boundBuffers[target]] };
+        if (buffer.size() < static_cast<size_t>(offset + size))
+            buffer.resize(offset + size);
+        m_uploaded += size;
+        return buffer.data() + offset;
+    }
+
+    GLint getUniformLocation(GLuint program, const GLchar* name)
+    {
+        auto it { m_uniformLocations.find({ program, name }) };
+        if (it == m_uniformLocations.end())
+            it = m_uniformLocations.emplace(std::make_pair(program, std::string { name }), m_uniformLocations.size()).first;
+        return it->second;
+    }
+
+    void getInteger(GLenum name, GLint* data)
+    {
+        switch (name) {
+        case GL_NUM_EXTENSIONS:
+            *data = 1; // glad refuses to load without any
+            break;
+        case GL_MAJOR_VERSION:
+        case GL_MINOR_VERSION:
+            *data = 3;
+            break;
+        case GL_MAX_TEXTURE_SIZE:
+            *data = 16384;
+            break;
+        case GL_VIEWPORT:
+            std::copy(m_viewport, m_viewport + 4, data);
+            break;
+        case GL_DRAW_FRAMEBUFFER_BINDING:
+            *data = m_drawFramebuffer;
+            break;
+        default:
+            *data = 0;
+        }
+    }
+
+    const GLubyte* getString(GLenum name)
+    {
+        switch (name) {
+        case GL_VERSION:
+            return reinterpret_cast<const GLubyte*>("3.3 (GL mock)");
+        case GL_SHADING_LANGUAGE_VERSION:
+            return reinterpret_cast<const GLubyte*>("3.30");
+        default:
+            return reinterpret_cast<const GLubyte*>("GL mock");
+        }
+    }
+
+    void setViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        m_viewport[0] = x;
+        m_viewport[1] = y;
+        m_viewport[2] = width;
+        m_viewport[3] = height;
+    }
+};
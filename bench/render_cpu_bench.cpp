@@ -0,0 +1,113 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "game.hpp"
+#include "gl_extensions.hpp"
+#include "gl_mock.hpp"
+#include "render_state.hpp"
+#include "resource_manager.hpp"
+
+// Runs Game::init and the game loop against GLMock instead of a driver, so what is measured is only the CPU cost
+// of our own render code: GL calls per frame by function, bytes uploaded, state changes and nanoseconds per frame.
+// Needs no display or GPU; run it from the Engine output directory, it loads the same shaders and resources.
+//
+//     render_cpu_bench [frames]
+
+const size_t screenWidth { 800 };
+const size_t screenHeight { 600 };
+const float timeStep { 1.0f / 60.0f };
+
+int main(int argc, char** argv)
+{
+    size_t frames { argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 1000 };
+
+    // assets are loaded relative to the working directory, without them init() can't find the textures it looks up
+    std::error_code error;
+    if (!std::filesystem::exists("sprite_batch.vert", error) || !std::filesystem::is_directory("textures", error)) {
+        std::cout << "Failed to find the shaders and resources, run from the Engine output directory" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    GLMock& mock { GLMock::get() };
+    if (!mock.load()) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return EXIT_FAILURE;
+    }
+    GLExtensions::get().load(&GLMock::getProcAddress);
+
+    RenderState::get().enable(GL_BLEND);
+    RenderState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    Game game { screenWidth, screenHeight };
+    ResourceManager resourceManager;
+    game.init(resourceManager);
+    std::cout << "init: " << mock.getTotalCount() << " GL calls, " << mock.getUploaded() / 1024 << " KB of buffer data, "
+              << mock.getCreated(BufferObject) << " buffers, " << mock.getCreated(TextureObject) << " textures, "
+              << mock.getCreated(ProgramObject) << " programs" << std::endl;
+
+    // same as main.cpp --headless: the ball is launched right away so bricks break during the run
+    game.setKey(GLFW_KEY_SPACE, true);
+
+    std::vector<uint64_t> calls(GLMockCallCount);
+    uint64_t uploaded { 0 }, stateCalls { 0 }, skippedStateCalls { 0 };
+    double seconds { 0.0 };
+
+    for (size_t frame { 0 }; frame < frames; ++frame) {
+        mock.resetCounts();
+        auto start { std::chrono::steady_clock::now() };
+
+        game.processInput(timeStep);
+        game.update(timeStep, resourceManager);
+        game.render(resourceManager);
+
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (size_t call { 0 }; call < GLMockCallCount; ++call)
+            calls[call] += mock.getCount(call);
+        uploaded += mock.getUploaded();
+        stateCalls += RenderState::get().getStats().m_issued;
+        skippedStateCalls += RenderState::get().getStats().m_skipped;
+    }
+
+    uint64_t total { 0 }, draws { 0 }, uniforms { 0 };
+    for (size_t call { 0 }; call < GLMockCallCount; ++call) {
+        std::string name { GLMock::getCallName(call) };
+        total += calls[call];
+        if (name.compare(0, 6, "glDraw") == 0)
+            draws += calls[call];
+        if (name.compare(0, 9, "glUniform") == 0 && name != "glUniformBlockBinding")
+            uniforms += calls[call];
+    }
+
+    std::cout << frames << " frames, " << seconds * 1e9 / frames << " ns per frame\n"
+              << "per frame: " << static_cast<double>(total) / frames << " GL calls, " << static_cast<double>(draws) / frames
+              << " draw calls, " << static_cast<double>(uniforms) / frames << " uniform uploads, "
+              << static_cast<double>(uploaded) / frames / 1024 << " KB of buffer data, " << static_cast<double>(stateCalls) / frames
+              << " state changes (" << static_cast<double>(skippedStateCalls) / frames << " redundant skipped)\n";
+
+    std::vector<size_t> order(GLMockCallCount);
+    for (size_t call { 0 }; call < order.size(); ++call)
+        order[call] = call;
+    std::sort(order.begin(), order.end(), [&calls](size_t a, size_t b) { return calls[a] > calls[b]; });
+
+    for (size_t call : order) {
+        if (calls[call] == 0)
+            break;
+        std::cout << "  " << std::left << std::setw(28) << GLMock::getCallName(call) << std::right << std::fixed
+                  << std::setprecision(2) << static_cast<double>(calls[call]) / frames << "\n";
+    }
+
+    std::cout << "live objects: " << mock.getLive(BufferObject) << " buffers, " << mock.getLive(TextureObject) << " textures, "
+              << mock.getLive(SyncObject) << " fences, " << mock.getLive(QueryObject) << " queries" << std::endl;
+
+    resourceManager.clear();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "radix_sort.hpp"
+#include "render_commands.hpp"
+
+// Sorts a frame's worth of draw keys the way RenderCommandBuffer does, times radixSort against the standard sorts
+// and counts how many shader and texture changes submitting in key order saves over submitting in recording order.
+//
+//     sort_key_bench [draws per frame] [frames]
+
+struct Draw {
+    uint64_t m_key;
+    uint32_t m_shader, m_texture;
+};
+
+size_t countStateChanges(const std::vector<Draw>& draws)
+{
+    size_t changes { 0 };
+    for (size_t i { 1 }; i < draws.size(); ++i)
+        changes += (draws[i].m_shader != draws[i - 1].m_shader) + (draws[i].m_texture != draws[i - 1].m_texture);
+    return changes;
+}
+
+template <typename Sort>
+void run(const char* name, Sort sort, const std::vector<Draw>& recorded, size_t frames)
+{
+    std::vector<Draw> draws;
+    double seconds { 0.0 };
+
+    for (size_t frame { 0 }; frame < frames; ++frame) {
+        draws = recorded;
+        auto start { std::chrono::steady_clock::now() };
+        sort(draws);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool isSorted { std::is_sorted(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) { return a.m_key < b.m_key; }) };
+    std::cout << "  " << name << ": " << seconds * 1e3 / frames << " ms per frame" << (isSorted ? "" : " NOT SORTED") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count { argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 100000 };
+    size_t frames { argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 100 };
+
+    // five layers, four programs, 64 textures, a third of the draws translucent
+    std::mt19937 random { 42 };
+    std::uniform_int_distribution<uint32_t> layer { 0, 4 }, shader { 0, 3 }, texture { 1, 64 }, translucent { 0, 2 };
+    std::uniform_real_distribution<float> depth { 0.0f, 1.0f };
+
+    std::vector<Draw> recorded(count);
+    for (auto& draw : recorded) {
+        draw.m_shader = shader(random);
+        draw.m_texture = texture(random);
+        draw.m_key = RenderCommandBuffer::makeDrawKey(RenderCommandBuffer::SPRITE_PASS + layer(random), translucent(random) == 0,
+            draw.m_shader, draw.m_texture, depth(random));
+    }
+
+    std::cout << count << " draws per frame, " << frames << " frames" << std::endl;
+    run("radix sort", [](std::vector<Draw>& draws) {
+        static std::vector<Draw> scratch;
+        radixSort(draws, scratch, [](const Draw& draw) { return draw.m_key; });
+    }, recorded, frames);
+    run("std::stable_sort", [](std::vector<Draw>& draws) {
+        std::stable_sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) { return a.m_key < b.m_key; });
+    }, recorded, frames);
+    run("std::sort", [](std::vector<Draw>& draws) {
+        std::sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) { return a.m_key < b.m_key; });
+    }, recorded, frames);
+
+    std::vector<Draw> sorted { recorded };
+    std::vector<Draw> scratch;
+    radixSort(sorted, scratch, [](const Draw& draw) { return draw.m_key; });
+    size_t before { countStateChanges(recorded) }, after { countStateChanges(sorted) };
+    std::cout << "state changes: " << before << " in recording order, " << after << " in key order (" << before - after << " saved, "
+              << 100.0 * (before - after) / before << "%)" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/glm.hpp>
+
+#include "sprite_vertices.hpp"
+
+// Builds the quads of many sprites with the glm path SpriteRenderer uses (a model matrix per sprite) and with
+// every compiled buildSpriteVertices kernel, once with no sprite rotated and once with all of them, and reports
+// the time per sprite and the largest difference to glm.
+//
+//     sprite_vertices_bench [sprites] [repetitions]
+
+// what SpriteRenderer::drawSprite and the sprite shader do, on the CPU
+void buildWithGlm(const SpriteArrays& sprites, SpriteVertex* vertices)
+{
+    const glm::vec2 corners[] { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+
+    for (size_t i { 0 }; i < sprites.size(); ++i) {
+        glm::vec2 size { sprites.m_width[i], sprites.m_height[i] };
+        glm::mat4 model { glm::mat4(1.0f) };
+        model = glm::translate(model, glm::vec3(sprites.m_x[i], sprites.m_y[i], 0.0f));
+        model = glm::translate(model, glm::vec3(0.5f * size.x, 0.5f * size.y, 0.0f));
+        model = glm::rotate(model, sprites.m_rotation[i], glm::vec3(0.0f, 0.0f, 1.0f));
+        model = glm::translate(model, glm::vec3(-0.5f * size.x, -0.5f * size.y, 0.0f));
+        model = glm::scale(model, glm::vec3(size, 1));
+
+        for (size_t corner { 0 }; corner < 4; ++corner) {
+            glm::vec4 position { model * glm::vec4(corners[corner], 0.0f, 1.0f) };
+            glm::vec2 uv { glm::vec2(sprites.m_u[i], sprites.m_v[i]) + corners[corner] * glm::vec2(sprites.m_uvWidth[i], sprites.m_uvHeight[i]) };
+            vertices[i * 4 + corner] = SpriteVertex { position.x, position.y, uv.x, uv.y, sprites.m_color[i] };
+        }
+    }
+}
+
+template <typename Build>
+void run(const char* name, Build build, const SpriteArrays& sprites, const std::vector<SpriteVertex>& reference, size_t repetitions)
+{
+    std::vector<SpriteVertex> vertices(sprites.size() * 4);
+
+    auto start { std::chrono::steady_clock::now() };
+    for (size_t repetition { 0 }; repetition < repetitions; ++repetition)
+        build(sprites, vertices.data());
+    double seconds { std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+    float error { 0.0f };
+    for (size_t i { 0 }; i < vertices.size(); ++i) {
+        error = std::max({ error, std::abs(vertices[i].m_x - reference[i].m_x), std::abs(vertices[i].m_y - reference[i].m_y),
+            std::abs(vertices[i].m_u - reference[i].m_u), std::abs(vertices[i].m_v - reference[i].m_v) });
+        if (vertices[i].m_color != reference[i].m_color)
+            error = INFINITY;
+    }
+
+    std::cout << "  " << name << ": " << seconds * 1e9 / (repetitions * sprites.size()) << " ns per sprite, max error " << error << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t count { argc > 1 ? static_cast<size_t>(std::atoi(argv[1])) : 10000 };
+    size_t repetitions { argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 500 };
+
+    for (bool isRotated : { false, true }) {
+        std::mt19937 random { 42 };
+        std::uniform_real_distribution<float> unit { 0.0f, 1.0f };
+
+        SpriteArrays sprites;
+        for (size_t i { 0 }; i < count; ++i) {
+            glm::vec2 position { unit(random) * 800.0f, unit(random) * 600.0f };
+            glm::vec2 size { 10.0f + unit(random) * 90.0f, 10.0f + unit(random) * 90.0f };
+            float rotation { isRotated ? (unit(random) * 2.0f - 1.0f) * glm::pi<float>() : 0.0f };
+            glm::vec4 uvRect { unit(random) * 0.5f, unit(random) * 0.5f, 0.25f, 0.25f };
+            sprites.push(position, size, rotation, uvRect, packColor(glm::vec4(unit(random), unit(random), unit(random), 1.0f)));
+        }
+
+        std::vector<SpriteVertex> reference(count * 4);
+        buildWithGlm(sprites, reference.data());
+
+        std::cout << count << (isRotated ? " rotated" : " axis aligned") << " sprites" << std::endl;
+        run("glm", buildWithGlm, sprites, reference, repetitions);
+        run("scalar", [](const SpriteArrays& s, SpriteVertex* v) { buildSpriteVertices<ScalarLanes>(s, v); }, sprites, reference, repetitions);
+#ifdef SPRITE_VERTICES_SSE2
+        run("sse2", [](const SpriteArrays& s, SpriteVertex* v) { buildSpriteVertices<Sse2Lanes>(s, v); }, sprites, reference, repetitions);
+#endif
+#ifdef SPRITE_VERTICES_AVX2
+        run("avx2", [](const SpriteArrays& s, SpriteVertex* v) { buildSpriteVertices<Avx2Lanes>(s, v); }, sprites, reference, repetitions);
+#endif
+#ifdef SPRITE_VERTICES_NEON
+        run("neon", [](const SpriteArrays& s, SpriteVertex* v) { buildSpriteVertices<NeonLanes>(s, v); }, sprites, reference, repetitions);
+#endif
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "gl_extensions.hpp"
+#include "render_state.hpp"
+#include "shader.hpp"
+#include "stream_buffer.hpp"
+
+// Streams a fixed amount of vertex data per frame through every StreamBuffer mode and reports the upload rate and
+// how long the CPU was blocked on fences. The vertices are drawn as points with rasterization off, so the GPU
+// really reads every byte without the fill rate getting in the way.
+//
+//     stream_buffer_bench [megabytes per frame] [frames]
+
+const size_t chunkSize { 64 * 1024 }; // roughly one sprite batch flush
+
+const char* vertexSource { R"(#version 330 core
+layout (location = 0) in vec4 vertex;
+void main() { gl_Position = vertex; }
+)" };
+
+const char* fragmentSource { R"(#version 330 core
+out vec4 color;
+void main() { color = vec4(1.0); }
+)" };
+
+void run(StreamBufferMode mode, const char* name, size_t bytesPerFrame, size_t frames)
+{
+    StreamBuffer buffer { GL_ARRAY_BUFFER, bytesPerFrame, mode };
+    if (buffer.getMode() != mode) {
+        std::cout << name << ": not supported" << std::endl;
+        return;
+    }
+
+    GLuint vertexArrayObject;
+    glGenVertexArrays(1, &vertexArrayObject);
+    RenderState::get().bindVertexArray(vertexArrayObject);
+    glEnableVertexAttribArray(0);
+
+    auto start { std::chrono::steady_clock::now() };
+
+    for (size_t frame { 0 }; frame < frames; ++frame) {
+        for (size_t uploaded { 0 }; uploaded < bytesPerFrame; uploaded += chunkSize) {
+            size_t size { std::min(chunkSize, bytesPerFrame - uploaded) };
+            size_t offset;
+            float* data { static_cast<float*>(buffer.map(size, offset)) };
+            for (size_t i { 0 }; i < size / sizeof(float); ++i)
+                data[i] = static_cast<float>(frame + i);
+            buffer.unmap();
+
+            RenderState::get().bindBuffer(GL_ARRAY_BUFFER, buffer.getID());
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)offset);
+            glDrawArrays(GL_POINTS, 0, size / (4 * sizeof(float)));
+        }
+        buffer.endFrame();
+    }
+    glFinish();
+
+    double seconds { std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+    const StreamBufferStats& stats { buffer.getStats() };
+    std::cout << name << ": " << stats.m_uploaded / (1024.0 * 1024.0) / seconds << " MB/s, "
+              << stats.m_waits << " sync waits, " << stats.m_waitTime / 1e6 << " ms waiting ("
+              << 100.0 * stats.m_waitTime / 1e9 / seconds << "% of " << seconds * 1e3 << " ms)" << std::endl;
+
+    RenderState::get().deleteVertexArray(vertexArrayObject);
+}
+
+int main(int argc, char** argv)
+{
+    size_t bytesPerFrame { static_cast<size_t>(argc > 1 ? std::atoi(argv[1]) : 4) * 1024 * 1024 };
+    size_t frames { argc > 2 ? static_cast<size_t>(std::atoi(argv[2])) : 300 };
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, false);
+
+    GLFWwindow* window = glfwCreateWindow(64, 64, "stream_buffer_bench", nullptr, nullptr);
+    if (window == nullptr) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return EXIT_FAILURE;
+    }
+    GLExtensions::get().load((GLADloadproc)glfwGetProcAddress);
+
+    std::cout << glGetString(GL_RENDERER) << ", " << bytesPerFrame / (1024 * 1024) << " MB per frame, " << frames << " frames" << std::endl;
+
+    Shader shader;
+    shader.compile(vertexSource, fragmentSource);
+    shader.use();
+    RenderState::get().enable(GL_RASTERIZER_DISCARD);
+
+    run(PersistentMapping, "persistent mapping", bytesPerFrame, frames);
+    run(UnsynchronizedMapping, "unsynchronized mapping", bytesPerFrame, frames);
+    run(Orphaning, "orphaning", bytesPerFrame, frames);
+
+    shader.deleteShader();
+    glfwTerminate();
+    return EXIT_SUCCESS;
+}
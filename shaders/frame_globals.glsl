@@ -0,0 +1,10 @@
+// included by every shader reading the per-frame values, the std140 layout of FrameGlobalsData in frame_globals.hpp
+
+layout (std140) uniform FrameGlobals {
+    mat4 projection;
+    vec2 screenSize;
+    float time;
+    bool confuse;
+    bool chaos;
+    bool shake;
+};
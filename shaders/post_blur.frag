@@ -0,0 +1,32 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 color;
+
+#include "post_processing.glsl"
+
+// taps on each side, counting the center; a constant so the loop unrolls
+#ifndef TAPS
+#define TAPS 2
+#endif
+
+// one direction of a separable blur, built with HORIZONTAL defined for the other one
+uniform vec2 texelSize; // of the resolution the pass works at
+uniform float offsets[TAPS]; // in texels, the first tap is the center
+uniform float weights[TAPS];
+
+void main()
+{
+#ifdef HORIZONTAL
+    vec2 direction = vec2(texelSize.x, 0.0);
+#else
+    vec2 direction = vec2(0.0, texelSize.y);
+#endif
+
+    // the taps are symmetric, each one but the center is taken on both sides
+    vec3 sum = sampleScene(TexCoords) * weights[0];
+    for (int i = 1; i < TAPS; i++)
+        sum += (sampleScene(TexCoords + direction * offsets[i]) + sampleScene(TexCoords - direction * offsets[i])) * weights[i];
+    color = vec4(sum, 1.0);
+}
@@ -0,0 +1,48 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+out vec4 color;
+
+#include "frame_globals.glsl"
+#include "post_processing.glsl"
+
+// built with CHAOS, CONFUSE or both; both give what a chaos pass followed by a confuse pass would
+#ifdef CHAOS
+// 3x3 convolution, rows from the top, and the distance between its taps in texture coordinates
+uniform float kernel[9];
+uniform vec2 offset;
+
+const vec2 taps[9] = vec2[](
+    vec2(-1.0, 1.0), vec2(0.0, 1.0), vec2(1.0, 1.0),
+    vec2(-1.0, 0.0), vec2(0.0, 0.0), vec2(1.0, 0.0),
+    vec2(-1.0, -1.0), vec2(0.0, -1.0), vec2(1.0, -1.0));
+#endif
+
+void main()
+{
+    vec2 coords = TexCoords;
+#ifdef CONFUSE
+    // upside down
+    coords = 1.0 - coords;
+#endif
+
+#ifdef CHAOS
+    // a convolution, edge detection by default, on a wobbling image
+    float strength = 0.3;
+    coords += vec2(sin(time), cos(time)) * strength;
+
+    vec3 sum = vec3(0.0);
+    for (int i = 0; i < 9; i++)
+        sum += sampleScene(coords + taps[i] * offset) * kernel[i];
+    vec3 result = clamp(sum, 0.0, 1.0); // as a target in between would have stored it
+#else
+    vec3 result = sampleScene(coords);
+#endif
+
+#ifdef CONFUSE
+    // inverted
+    result = 1.0 - result;
+#endif
+    color = vec4(result, 1.0);
+}
@@ -0,0 +1,23 @@
+// included by the effect passes: the output of the pass before, or the scene itself for the first pass, which
+// then may read the multisampled scene directly
+
+#ifdef MSAA_RESOLVE
+uniform sampler2DMS scene;
+#else
+uniform sampler2D scene;
+#endif
+
+// the input at a texture coordinate, wrapping around outside [0, 1]
+vec3 sampleScene(vec2 coords)
+{
+#ifdef MSAA_RESOLVE
+    // resolves the nearest texel here instead of in a blit beforehand
+    ivec2 texel = ivec2(fract(coords) * vec2(textureSize(scene)));
+    vec3 sum = vec3(0.0);
+    for (int i = 0; i < SAMPLES; i++)
+        sum += texelFetch(scene, texel, i).rgb;
+    return sum / float(SAMPLES);
+#else
+    return texture(scene, coords).rgb;
+#endif
+}
@@ -0,0 +1,16 @@
+#version 330 core
+
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+
+out vec2 TexCoords;
+
+#include "frame_globals.glsl"
+
+void main()
+{
+    float strength = 0.01;
+    gl_Position = vec4(vertex.xy, 0.0, 1.0);
+    gl_Position.x += cos(time * 10) * strength;
+    gl_Position.y += cos(time * 15) * strength;
+    TexCoords = vertex.zw;
+}
@@ -5,10 +5,12 @@ layout(location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 projection;
+uniform vec4 uvRect; // <vec2 offset, vec2 size>
+
+#include "frame_globals.glsl"
 
 void main()
 {
-    TexCoords = vertex.zw;
+    TexCoords = uvRect.xy + vertex.zw * uvRect.zw;
     gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
 }
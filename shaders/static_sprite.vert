@@ -0,0 +1,33 @@
+#version 330 core
+
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec4 instanceRect; // <vec2 position, vec2 size>
+layout (location = 2) in vec4 instanceUVRect; // <vec2 offset, vec2 size>
+layout (location = 3) in vec4 instanceColor; // <vec3 color, float rotation>
+
+out vec2 TexCoords;
+out vec3 SpriteColor;
+
+uniform usamplerBuffer hidden; // one byte per instance, non-zero hides it
+uniform int firstInstance; // where the current run starts in the mask
+
+#include "frame_globals.glsl"
+
+void main()
+{
+    TexCoords = instanceUVRect.xy + vertex.zw * instanceUVRect.zw;
+    SpriteColor = instanceColor.rgb;
+
+    // collapse hidden sprites to a point outside the view, their triangles are dropped before rasterization
+    if (texelFetch(hidden, firstInstance + gl_InstanceID).r != 0u) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    // rotate around the center of the sprite, then move it into place
+    vec2 local = (vertex.xy - 0.5) * instanceRect.zw;
+    float s = sin(instanceColor.w);
+    float c = cos(instanceColor.w);
+    vec2 rotated = vec2(c * local.x - s * local.y, s * local.x + c * local.y);
+    gl_Position = projection * vec4(rotated + instanceRect.xy + 0.5 * instanceRect.zw, 0.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec2 TilePosition;
+
+out vec4 color;
+
+uniform sampler2D image;
+uniform usampler2D tiles;
+uniform vec4 tileColors[16];
+uniform vec4 tileUVRects[16]; // <vec2 offset, vec2 size>
+
+void main()
+{
+    ivec2 cell = min(ivec2(TilePosition), textureSize(tiles, 0) - 1);
+    uint code = min(texelFetch(tiles, cell, 0).r, 15u);
+    if (code == 0u)
+        discard;
+
+    vec4 uvRect = tileUVRects[code];
+    color = tileColors[code] * texture(image, uvRect.xy + (TilePosition - vec2(cell)) * uvRect.zw);
+}
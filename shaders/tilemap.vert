@@ -0,0 +1,21 @@
+#version 330 core
+
+out vec2 TilePosition; // in tiles, from the top left corner of the map
+
+uniform vec4 rect; // <vec2 position, vec2 size> of the whole map
+uniform vec2 tileCount;
+
+#include "frame_globals.glsl"
+
+// the same two triangles as a sprite quad
+const vec2 corners[6] = vec2[](
+    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(0.0, 0.0),
+    vec2(0.0, 1.0), vec2(1.0, 1.0), vec2(1.0, 0.0)
+);
+
+void main()
+{
+    vec2 corner = corners[gl_VertexID];
+    TilePosition = corner * tileCount;
+    gl_Position = projection * vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.hpp"
+
+// Taps of one direction of a separable Gaussian blur for post_blur.frag. Pairs of neighbouring texels are merged
+// into a single bilinear fetch between them, placed so the filtering weighs the two like the kernel does, which
+// takes a kernel of radius r down from 2r + 1 fetches to r + 1 (rounded up to odd) per direction.
+struct BlurKernel {
+    static constexpr size_t MAX_TAPS { 16 }; // the center and one side
+    static constexpr size_t MAX_RADIUS { 2 * (MAX_TAPS - 1) };
+
+    float m_offsets[MAX_TAPS]; // in texels
+    float m_weights[MAX_TAPS];
+    int m_count;
+};
+
+// radius in texels of the blur pass, up to BlurKernel::MAX_RADIUS
+inline BlurKernel makeGaussianKernel(size_t radius, float sigma)
+{
+    radius = std::min(radius, BlurKernel::MAX_RADIUS);
+    sigma = std::max(sigma, 0.1f);
+
+    float weights[BlurKernel::MAX_RADIUS + 1];
+    float sum { 0.0f };
+    for (size_t i { 0 }; i <= radius; ++i) {
+        weights[i] = std::exp(-0.5f * i * i / (sigma * sigma));
+        sum += i == 0 ? weights[i] : 2.0f * weights[i];
+    }
+
+    BlurKernel kernel;
+    kernel.m_offsets[0] = 0.0f;
+    kernel.m_weights[0] = weights[0] / sum;
+    kernel.m_count = 1;
+
+    for (size_t i { 1 }; i <= radius; i += 2) {
+        float weight { weights[i] + (i < radius ? weights[i + 1] : 0.0f) };
+        float offset { (i * weights[i] + (i < radius ? (i + 1) * weights[i + 1] : 0.0f)) / weight };
+        kernel.m_offsets[kernel.m_count] = offset;
+        kernel.m_weights[kernel.m_count] = weight / sum;
+        ++kernel.m_count;
+    }
+
+    return kernel;
+}
+
+// for either direction of a blur, the shader has to be built with TAPS defined as the kernel's count
+inline void setBlurKernel(const Shader& shader, const BlurKernel& kernel)
+{
+    shader.use();
+    shader.setFloatArray("offsets", kernel.m_offsets, kernel.m_count);
+    shader.setFloatArray("weights", kernel.m_weights, kernel.m_count);
+}
+
+// a 3x3 kernel, rows from the top, with its taps offset apart in texture coordinates
+inline void setConvolutionKernel(const Shader& shader, const float (&kernel)[9], glm::vec2 offset)
+{
+    shader.use();
+    shader.setFloatArray("kernel", kernel, 9);
+    shader.setVec2("offset", offset);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+
+// Picks the scale the scene is rendered at from the measured GPU frame time, so a slow machine drops resolution
+// instead of frames. The scale moves in steps: down once the smoothed frame time has stayed over budget for a few
+// frames, up only after a long stretch in which the frame time scaled to the next step's pixel count would still fit
+// the budget, and not at all for a while after a change, while the timings coming back still belong to the old scale.
+class DynamicResolution {
+public:
+    DynamicResolution(double budget, float minScale = 0.5f, float maxScale = 2.0f, float step = 0.25f)
+        : m_budget { budget }
+        , m_minScale { minScale }
+        , m_maxScale { maxScale }
+        , m_step { step }
+        , m_scale { 1.0f }
+        , m_average { 0.0 }
+        , m_over { 0 }
+        , m_under { 0 }
+        , m_cooldown { 0 }
+        , m_isEnabled { true }
+    {
+    }
+
+    // takes the GPU time of a frame in milliseconds, returns true if the scale changed
+    bool update(double frameTime)
+    {
+        if (!m_isEnabled)
+            return false;
+        if (m_cooldown > 0) {
+            --m_cooldown;
+            return false;
+        }
+
+        m_average = m_average == 0.0 ? frameTime : m_average + (frameTime - m_average) * SMOOTHING;
+
+        if (m_average > m_budget) {
+            m_under = 0;
+            if (++m_over >= DOWN_FRAMES && m_scale > m_minScale)
+                return setScale(m_scale - m_step);
+        } else if (m_scale < m_maxScale && m_average * getStepUpCost() < m_budget * MARGIN) {
+            m_over = 0;
+            if (++m_under >= UP_FRAMES)
+                return setScale(m_scale + m_step);
+        } else {
+            m_over = 0;
+            m_under = 0;
+        }
+        return false;
+    }
+
+    // returns true if the scale changed
+    bool setScale(float scale)
+    {
+        float previous { m_scale };
+        m_scale = std::clamp(scale, m_minScale, m_maxScale);
+        m_average = 0.0;
+        m_over = 0;
+        m_under = 0;
+        m_cooldown = COOLDOWN_FRAMES;
+        return m_scale != previous;
+    }
+
+    float getScale() const { return m_scale; }
+
+    // a disabled controller keeps whatever scale it has
+    void setEnabled(bool isEnabled) { m_isEnabled = isEnabled; }
+
+    bool isEnabled() const { return m_isEnabled; }
+
+private:
+    static constexpr double SMOOTHING { 0.2 };
+    static constexpr double MARGIN { 0.9 }; // of the budget a step up is expected to use at most
+    static constexpr size_t DOWN_FRAMES { 8 };
+    static constexpr size_t UP_FRAMES { 120 };
+    static constexpr size_t COOLDOWN_FRAMES { 8 }; // a bit more than the frames a profiler result lags behind
+
+    double m_budget;
+    float m_minScale, m_maxScale, m_step, m_scale;
+    double m_average;
+    size_t m_over, m_under, m_cooldown;
+    bool m_isEnabled;
+
+    // how much more a frame costs one step up, the cost goes with the pixel count and so with the square of the scale
+    double getStepUpCost() const
+    {
+        double ratio { std::min(m_scale + m_step, m_maxScale) / m_scale };
+        return ratio * ratio;
+    }
+};
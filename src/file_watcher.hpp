@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <errno.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Collects the files written in a few directories, for reloading them while the game runs. A thread waits on inotify
+// for them, so asking whether anything changed is a single atomic load. Only Linux can watch directories, elsewhere
+// nothing ever changes.
+class FileWatcher {
+public:
+    FileWatcher()
+        : m_hasChanges { false }
+    {
+#ifdef __linux__
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0 || pipe(m_stop) != 0) {
+            std::cerr << "ERROR::FILEWATCHER: Failed to initialize inotify" << std::endl;
+            return;
+        }
+        m_thread = std::thread { &FileWatcher::run, this };
+#endif
+    }
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    ~FileWatcher()
+    {
+#ifdef __linux__
+        if (m_thread.joinable()) {
+            char stop { 0 };
+            if (write(m_stop[1], &stop, 1) == 1)
+                m_thread.join();
+            else
+                m_thread.detach();
+        }
+        for (int fd : { m_fd, m_stop[0], m_stop[1] }) {
+            if (fd >= 0)
+                close(fd);
+        }
+#endif
+    }
+
+    // only the files right in it, returns false if it can't be watched
+    bool watch(const std::string& directory)
+    {
+#ifdef __linux__
+        std::lock_guard<std::mutex> lock { m_mutex };
+        // editors either write the file or rename a new one over it
+        int descriptor { m_fd >= 0 ? inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) : -1 };
+        if (descriptor < 0)
+            return false;
+        m_directories[descriptor] = directory;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool hasChanges() const { return m_hasChanges.load(std::memory_order_acquire); }
+
+    // paths of the files written since the last call, each once
+    std::vector<std::string> takeChanges()
+    {
+        std::lock_guard<std::mutex> lock { m_mutex };
+        std::vector<std::string> changes { m_changes.begin(), m_changes.end() };
+        m_changes.clear();
+        m_hasChanges.store(false, std::memory_order_release);
+        return changes;
+    }
+
+private:
+    int m_fd { -1 };
+    int m_stop[2] { -1, -1 }; // a pipe, written to wake the thread up for good
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::map<int, std::string> m_directories;
+    std::set<std::string> m_changes;
+    std::atomic<bool> m_hasChanges;
+
+#ifdef __linux__
+    void run()
+    {
+        alignas(inotify_event) char buffer[4096];
+        pollfd descriptors[2] { { m_fd, POLLIN, 0 }, { m_stop[0], POLLIN, 0 } };
+
+        while (true) {
+            if (poll(descriptors, 2, -1) < 0 && errno != EINTR)
+                return;
+            if (descriptors[1].revents != 0)
+                return;
+
+            ssize_t length;
+            while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+                std::lock_guard<std::mutex> lock { m_mutex };
+                for (char* next { buffer }; next < buffer + length;) {
+                    const inotify_event* event { reinterpret_cast<const inotify_event*>(next) };
+                    auto it { m_directories.find(event->wd) };
+                    if (event->len > 0 && it != m_directories.end())
+                        m_changes.insert(it->second + "/" + event->name);
+                    next += sizeof(inotify_event) + event->len;
+                }
+                m_hasChanges.store(!m_changes.empty(), std::memory_order_release);
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstring>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_state.hpp"
+
+// binding point the FrameGlobals block of every shader is attached to
+const GLuint FRAME_GLOBALS_BINDING { 0 };
+
+// std140 layout of the FrameGlobals block, keep in sync with shaders/frame_globals.glsl:
+//
+//     layout (std140) uniform FrameGlobals {
+//         mat4 projection;
+//         vec2 screenSize;
+//         float time;
+//         bool confuse;
+//         bool chaos;
+//         bool shake;
+//     };
+struct FrameGlobalsData {
+    glm::mat4 m_projection;
+    glm::vec2 m_screenSize;
+    float m_time;
+    GLint m_confuse;
+    GLint m_chaos;
+    GLint m_shake;
+    GLint m_padding[2];
+};
+
+static_assert(sizeof(FrameGlobalsData) == 96, "FrameGlobalsData must match the std140 layout of FrameGlobals");
+
+// Values every shader can read without its own uniforms, uploaded at most once per frame.
+class FrameGlobals {
+public:
+    FrameGlobals()
+        : m_data {}
+        , m_isDirty { true }
+    {
+        glGenBuffers(1, &m_uniformBufferObject);
+        RenderState::get().bindBuffer(GL_UNIFORM_BUFFER, m_uniformBufferObject);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameGlobalsData), nullptr, GL_DYNAMIC_DRAW);
+        RenderState::get().bindBufferBase(GL_UNIFORM_BUFFER, FRAME_GLOBALS_BINDING, m_uniformBufferObject);
+    }
+
+    ~FrameGlobals() { RenderState::get().deleteBuffer(m_uniformBufferObject); }
+
+    void setProjection(const glm::mat4& projection) { change(m_data.m_projection, projection); }
+
+    void setScreenSize(glm::vec2 screenSize) { change(m_data.m_screenSize, screenSize); }
+
+    void setTime(float time) { change(m_data.m_time, time); }
+
+    void setEffects(bool confuse, bool chaos, bool shake)
+    {
+        change(m_data.m_confuse, static_cast<GLint>(confuse));
+        change(m_data.m_chaos, static_cast<GLint>(chaos));
+        change(m_data.m_shake, static_cast<GLint>(shake));
+    }
+
+    // sends the block if anything changed since the last upload
+    void upload()
+    {
+        if (!m_isDirty)
+            return;
+
+        RenderState::get().bindBuffer(GL_UNIFORM_BUFFER, m_uniformBufferObject);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameGlobalsData), &m_data);
+        m_isDirty = false;
+    }
+
+    const FrameGlobalsData& getData() const { return m_data; }
+
+private:
+    FrameGlobalsData m_data;
+    bool m_isDirty;
+    GLuint m_uniformBufferObject;
+
+    template <typename T>
+    void change(T& field, const T& value)
+    {
+        if (std::memcmp(&field, &value, sizeof(T)) != 0) {
+            field = value;
+            m_isDirty = true;
+        }
+    }
+};
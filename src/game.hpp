@@ -3,16 +3,28 @@
 #include <GLFW/glfw3.h>
 #include <glad/glad.h>
 
+#include <algorithm>
+#include <cmath>
+#include <string>
 #include <vector>
 
 #include "ball_object.hpp"
+#include "convolution.hpp"
+#include "dynamic_resolution.hpp"
+#include "frame_globals.hpp"
 #include "game_level.hpp"
 #include "game_object.hpp"
+#include "gpu_profiler.hpp"
+#include "layer_cache.hpp"
 #include "particle_generator.hpp"
 #include "post_processor.hpp"
 #include "power_up.hpp"
+#include "render_backend.hpp"
+#include "render_commands.hpp"
+#include "render_state.hpp"
 #include "resource_manager.hpp"
-#include "sprite_renderer.hpp"
+#include "sprite_batch.hpp"
+#include "thread_pool.hpp"
 
 enum GameState {
     Active,
@@ -33,6 +45,19 @@ struct Collision {
     glm::vec2 difference;
 };
 
+// a post-processing pass and the shaders it is built from, one variant for each combination of its effects
+struct EffectFile {
+    std::vector<std::string> effects;
+    std::vector<std::string> features; // the define that adds each effect, none for a pass of one effect
+    const char* pass;
+    const char* vertexShader;
+    const char* fragmentShader;
+    const char* define; // added to every variant
+    float scale;
+    bool isFusable; // also built with MSAA_RESOLVE, to read the multisampled scene when it comes first
+    bool isBlur; // post_blur.frag, built with the tap count of the kernel
+};
+
 class Game {
 public:
     Game(size_t width, size_t height)
@@ -40,72 +65,107 @@ public:
         , m_keys(1024)
         , m_width { width }
         , m_height { height }
+        , m_framebufferWidth { width }
+        , m_framebufferHeight { height }
+        , m_resolution { m_gpuBudget }
     {
     }
 
     ~Game()
     {
-        delete m_renderer;
+        delete m_backend;
+        delete m_profiler;
+        delete m_batch;
         delete m_player;
         delete m_ball;
         delete m_particles;
+        delete m_threadPool;
+        delete m_layerCache;
+        delete m_effects;
+        delete m_frameGlobals;
     }
 
     void init(ResourceManager& resourceManager)
     {
-        // load shaders
-        resourceManager.loadShader("sprite", "shader.vert", "shader.frag");
-        resourceManager.loadShader("particle", "particle.vert", "particle.frag");
-        resourceManager.loadShader("postprocessing", "post_processing.vert", "post_processing.frag");
+        // load shaders, the driver compiles them while textures and levels load
+        resourceManager.submitShader("sprite", "sprite_batch.vert", "sprite_batch.frag");
+        resourceManager.submitShader("static_sprite", "static_sprite.vert", "sprite_batch.frag");
+        resourceManager.submitShader("tilemap", "tilemap.vert", "tilemap.frag");
+        resourceManager.submitShader("particle", "particle.vert", "particle.frag");
+        for (const auto& file : m_effectFiles)
+            submitEffect(resourceManager, file);
+
+        // shared per-frame uniforms
+        m_frameGlobals = new FrameGlobals {};
+        m_frameGlobals->setProjection(glm::ortho(0.0f, static_cast<float>(m_width), static_cast<float>(m_height), 0.0f, -1.0f, 1.0f));
+        m_frameGlobals->setScreenSize(glm::vec2(m_width, m_height));
+
+        // load textures
+        resourceManager.loadTexture("textures/background.jpg", false, "background");
+        resourceManager.loadTextureAtlas({
+            { "textures/awesomeface.png", true, "face" },
+            { "textures/block.png", false, "block" },
+            { "textures/block_solid.png", false, "block_solid" },
+            { "textures/paddle.png", true, "paddle" },
+            { "textures/particle.png", true, "particle" },
+            { "textures/powerup_speed.png", true, "powerup_speed" },
+            { "textures/powerup_sticky.png", true, "powerup_sticky" },
+            { "textures/powerup_increase.png", true, "powerup_increase" },
+            { "textures/powerup_confuse.png", true, "powerup_confuse" },
+            { "textures/powerup_chaos.png", true, "powerup_chaos" },
+            { "textures/powerup_passthrough.png", true, "powerup_passthrough" },
+        });
+
+        // load levels, in place as they own their geometry on the GPU
+        m_levels.resize(m_levelFiles.size());
+        for (size_t i { 0 }; i < m_levels.size(); ++i)
+            m_levels[i].load(resourceManager, m_levelFiles[i], m_width, m_height / 2);
+        m_level = 0;
+        m_cachedLevel = m_levels.size();
+
+        resourceManager.finishShaders();
 
         // configure shader
         Shader shader { resourceManager.getShader("sprite") };
-        glm::mat4 projection { glm::ortho(0.0f, static_cast<float>(m_width), static_cast<float>(m_height), 0.0f, -1.0f, 1.0f) };
         shader.use();
         shader.setInt("image", 0);
-        shader.setMat4("projection", projection);
+
+        // configure static sprite shader
+        Shader staticSpriteShader { resourceManager.getShader("static_sprite") };
+        staticSpriteShader.use();
+        staticSpriteShader.setInt("image", 0);
+        staticSpriteShader.setInt("hidden", HIDDEN_MASK_UNIT);
+
+        // configure tilemap shader
+        Shader tilemapShader { resourceManager.getShader("tilemap") };
+        tilemapShader.use();
+        tilemapShader.setInt("image", 0);
+        tilemapShader.setInt("tiles", TILE_CODES_UNIT);
 
         // configure particle shader
         Shader particleShader { resourceManager.getShader("particle") };
         particleShader.use();
         particleShader.setInt("sprite", 0);
-        particleShader.setMat4("projection", projection);
-
-        // configure post processing shader
-        Shader postProcessingShader { resourceManager.getShader("postprocessing") };
-
-        // load textures
-        resourceManager.loadTexture("textures/background.jpg", false, "background");
-        resourceManager.loadTexture("textures/awesomeface.png", true, "face");
-        resourceManager.loadTexture("textures/block.png", false, "block");
-        resourceManager.loadTexture("textures/block_solid.png", false, "block_solid");
-        resourceManager.loadTexture("textures/paddle.png", true, "paddle");
-        resourceManager.loadTexture("textures/particle.png", true, "particle");
-        resourceManager.loadTexture("textures/powerup_speed.png", true, "powerup_speed");
-        resourceManager.loadTexture("textures/powerup_sticky.png", true, "powerup_sticky");
-        resourceManager.loadTexture("textures/powerup_increase.png", true, "powerup_increase");
-        resourceManager.loadTexture("textures/powerup_confuse.png", true, "powerup_confuse");
-        resourceManager.loadTexture("textures/powerup_chaos.png", true, "powerup_chaos");
-        resourceManager.loadTexture("textures/powerup_passthrough.png", true, "powerup_passthrough");
 
         // set render-specific controls
         Texture2D particleTexture { resourceManager.getTexture("particle") };
-        m_renderer = new SpriteRenderer { shader };
+        m_batch = new SpriteBatch { shader };
         m_particles = new ParticleGenerator { particleShader, particleTexture, 500 };
-        m_effects = new PostProcessor { postProcessingShader, 2 * m_width, 2 * m_height };
-
-        // load levels
-        GameLevel levelOne, levelTwo, levelThree, levelFour;
-        levelOne.load(resourceManager, "levels/one.lvl", m_width, m_height / 2);
-        levelTwo.load(resourceManager, "levels/two.lvl", m_width, m_height / 2);
-        levelThree.load(resourceManager, "levels/three.lvl", m_width, m_height / 2);
-        levelFour.load(resourceManager, "levels/four.lvl", m_width, m_height / 2);
-
-        m_levels.push_back(levelOne);
-        m_levels.push_back(levelTwo);
-        m_levels.push_back(levelThree);
-        m_levels.push_back(levelFour);
-        m_level = 0;
+        m_threadPool = new ThreadPool {};
+        m_batch->setThreadPool(m_threadPool);
+        m_particles->setThreadPool(m_threadPool);
+        m_effects = new PostProcessor { getRenderWidth(), getRenderHeight() };
+        m_effects->setOutputSize(m_framebufferWidth, m_framebufferHeight);
+        for (const auto& file : m_effectFiles) {
+            m_effects->addPass(file.effects, file.pass, resourceManager.getShaderVariants(file.pass), PostProcessor::SCENE_FORMAT,
+                PostProcessor::SCENE_FORMAT, file.scale);
+        }
+        setChaosKernel({ -1.0f, -1.0f, -1.0f, -1.0f, 8.0f, -1.0f, -1.0f, -1.0f, -1.0f }, glm::vec2(1.0f / 300.0f));
+        setShakeBlur(resourceManager, 2, 0.8f);
+        m_layerCache = new LayerCache { getRenderWidth(), getRenderHeight(), PostProcessor::SAMPLES, PostProcessor::SCENE_FORMAT };
+        m_backend = new RenderBackend { *m_batch, staticSpriteShader, tilemapShader, *m_particles, *m_effects, *m_layerCache, *m_frameGlobals };
+        m_profiler = new GpuProfiler { "gpu_profile.log" };
+        m_backend->setProfiler(m_profiler);
 
         // initialize player
         glm::vec2 playerPos { m_width / 2.0f - m_playerSize.x / 2.0f, m_height - m_playerSize.y };
@@ -137,7 +197,7 @@ public:
             m_shakeTime -= deltaTime;
 
             if (m_shakeTime <= 0.0f)
-                m_effects->setShake(false);
+                m_effects->setEnabled("shake", false);
         }
 
         // check loss condition
@@ -149,38 +209,56 @@ public:
 
     void render(const ResourceManager& resourceManager)
     {
-        if (m_state == Active) {
-            // begin rendering to postprocessing framebuffer
-            m_effects->beginRender();
+        // count the state changes of this frame only
+        RenderState::get().resetStats();
 
-            // draw background
-            Texture2D texture { resourceManager.getTexture("background") };
-            m_renderer->drawSprite(texture, glm::vec2(0.0f, 0.0f), glm::vec2(m_width, m_height), 0.0f);
-
-            // draw level
-            m_levels[m_level].draw(*m_renderer);
-
-            // draw player
-            m_player->draw(*m_renderer);
-
-            // draw powerups
-            for (auto& powerUp : m_powerUps) {
-                if (!powerUp.getIsDestroyed())
-                    powerUp.draw(*m_renderer);
-            }
+        if (m_state == Active) {
+            m_commands.clear();
+            record(resourceManager, m_commands);
+            m_commands.sort();
+            m_profiler->beginFrame();
+            m_backend->execute(m_commands);
+            m_profiler->endFrame();
+
+            double frameTime { 0.0 };
+            if (m_profiler->takeFrameTime(frameTime) && m_resolution.update(frameTime))
+                applyRenderScale();
+        }
+    }
 
-            // draw particles
-            m_particles->draw();
+    // writes the current frame into commands without touching GL
+    void record(const ResourceManager& resourceManager, RenderCommandBuffer& commands)
+    {
+        commands.setEffects(glfwGetTime(), m_effects->isEnabled("confuse"), m_effects->isEnabled("chaos"), m_effects->isEnabled("shake"));
+        commands.beginPostProcess();
+
+        // background and level are kept in the layer cache, they only have to be drawn where the level changed
+        glm::vec4 region { 0.0f };
+        bool isLevelChanged { m_levels[m_level].takeDirtyRegion(region) };
+        if (m_cachedLevel != m_level)
+            region = glm::vec4(0.0f, 0.0f, m_width, m_height);
+        else if (!isLevelChanged)
+            region = glm::vec4(0.0f);
+        m_cachedLevel = m_level;
+        commands.beginCachedLayers(BackgroundLayer, region);
+
+        Texture2D texture { resourceManager.getTexture("background") };
+        commands.drawSprite(BackgroundLayer, texture, glm::vec2(0.0f, 0.0f), glm::vec2(m_width, m_height), 0.0f, glm::vec3(1.0f));
+
+        m_levels[m_level].draw(commands);
+        commands.endCachedLayers(LevelLayer);
+        m_player->draw(commands, ObjectLayer);
 
-            // draw ball
-            m_ball->draw(*m_renderer);
+        for (const auto& powerUp : m_powerUps) {
+            if (!powerUp.getIsDestroyed())
+                powerUp.draw(commands, ObjectLayer);
+        }
 
-            // end rendering to postprocessing framebuffer
-            m_effects->endRender();
+        // the ball goes on top of its particles
+        m_particles->record(commands, ParticleLayer);
+        m_ball->draw(commands, ForegroundLayer);
 
-            //  render postprocessing quad
-            m_effects->render(glfwGetTime());
-        }
+        commands.endPostProcess();
     }
 
     void processInput(float deltaTime)
@@ -213,35 +291,166 @@ public:
 
     void setKey(int key, bool isPressed) { m_keys[key] = isPressed; }
 
+    // the scene is rendered at this size times the render scale and scaled to it when post-processing
+    void setFramebufferSize(size_t width, size_t height)
+    {
+        m_framebufferWidth = width;
+        m_framebufferHeight = height;
+        m_effects->setOutputSize(width, height);
+        applyRenderScale();
+    }
+
+    // a fixed scale turns off adjusting it to the GPU frame time
+    void setRenderScale(float scale, bool isDynamic)
+    {
+        m_resolution.setScale(scale);
+        m_resolution.setEnabled(isDynamic);
+        applyRenderScale();
+    }
+
+    float getRenderScale() const { return m_resolution.getScale(); }
+
+    // 3x3 kernel of the chaos effect, rows from the top, offset is the distance between its taps in texture coordinates
+    void setChaosKernel(const float (&kernel)[9], glm::vec2 offset)
+    {
+        for (const auto& it : m_effects->getShaders("effects").getVariants())
+            setConvolutionKernel(it.second, kernel, offset);
+    }
+
+    // the shake effect blurs at half resolution, radius and sigma are in those texels
+    void setShakeBlur(ResourceManager& resourceManager, size_t radius, float sigma)
+    {
+        BlurKernel kernel { makeGaussianKernel(radius, sigma) };
+        for (const auto& file : m_effectFiles) {
+            if (!file.isBlur)
+                continue;
+
+            // the tap count is built into the blur shaders, another one takes new programs
+            if (kernel.m_count != m_blurTaps) {
+                ShaderVariants previous { resourceManager.getShaderVariants(file.pass) };
+                submitEffect(resourceManager, file, kernel.m_count);
+                m_effects->setShaders(file.pass, resourceManager.getShaderVariants(file.pass));
+                previous.deleteShaders();
+            }
+            for (const auto& it : m_effects->getShaders(file.pass).getVariants())
+                setBlurKernel(it.second, kernel);
+        }
+        m_blurTaps = kernel.m_count;
+    }
+
+    // a file changed on disk, levels start over from it, anything else goes to the resource manager
+    void reload(ResourceManager& resourceManager, const std::string& file)
+    {
+        for (size_t i { 0 }; i < m_levelFiles.size(); ++i) {
+            if (m_levelFiles[i] == file)
+                m_levels[i].load(resourceManager, file, m_width, m_height / 2);
+        }
+        if (file.compare(0, 7, "levels/") != 0)
+            resourceManager.reload(file);
+
+        // the cached layers may show the old level or textures
+        m_cachedLevel = m_levels.size();
+    }
+
+    // once a frame, nearly free while no shader is being rebuilt
+    void finishReloads(ResourceManager& resourceManager)
+    {
+        if (resourceManager.finishReloads())
+            m_cachedLevel = m_levels.size();
+    }
+
+    // GPU time of each render pass, also written to gpu_profile.log every few seconds
+    const GpuProfiler& getProfiler() const { return *m_profiler; }
+
 private:
-    SpriteRenderer* m_renderer;
+    RenderCommandBuffer m_commands;
+    RenderBackend* m_backend;
+    GpuProfiler* m_profiler;
+    LayerCache* m_layerCache;
+    SpriteBatch* m_batch;
     PostProcessor* m_effects;
+    FrameGlobals* m_frameGlobals;
     ParticleGenerator* m_particles;
+    ThreadPool* m_threadPool;
     GameObject* m_player;
     BallObject* m_ball;
     GameState m_state;
     std::vector<GameLevel> m_levels;
     std::vector<PowerUp> m_powerUps;
     std::vector<bool> m_keys;
-    size_t m_width, m_height, m_level;
+    size_t m_width, m_height, m_level, m_cachedLevel;
+    size_t m_framebufferWidth, m_framebufferHeight;
+    const double m_gpuBudget { 12.0 }; // milliseconds, leaves some of a 60 Hz frame to the CPU and compositor
+    DynamicResolution m_resolution;
     float m_shakeTime { 0.0f };
     const glm::vec2 m_playerSize { 100.0f, 20.0f };
     const glm::vec2 m_initialBallVelocity { 100.0f, -350.0f };
     const float m_playerVelocity { 500.0f };
     const float m_ballRadius { 12.5f };
+    // post-processing passes in the order they are applied, chaos and confuse share one; shake blurs in two directions
+    // at half resolution and jitters in the second one
+    const std::vector<EffectFile> m_effectFiles {
+        { { "chaos", "confuse" }, { "CHAOS", "CONFUSE" }, "effects", "post_processing.vert", "post_effects.frag", nullptr, 1.0f, true, false },
+        { { "shake" }, {}, "shake_blur_x", "post_processing.vert", "post_blur.frag", "HORIZONTAL", 0.5f, false, true },
+        { { "shake" }, {}, "shake_blur_y", "post_shake.vert", "post_blur.frag", nullptr, 0.5f, false, true },
+    };
+    int m_blurTaps { 2 }; // the blur shaders are built with
+    const std::vector<std::string> m_levelFiles { "levels/one.lvl", "levels/two.lvl", "levels/three.lvl", "levels/four.lvl" };
+
+    std::vector<std::string> getDefines(const EffectFile& file, int blurTaps = 0) const
+    {
+        std::vector<std::string> defines;
+        if (file.define != nullptr)
+            defines.push_back(file.define);
+        if (file.isBlur)
+            defines.push_back("TAPS " + std::to_string(blurTaps > 0 ? blurTaps : m_blurTaps));
+        if (file.isFusable)
+            defines.push_back("SAMPLES " + std::to_string(PostProcessor::SAMPLES));
+        return defines;
+    }
+
+    // a variant for every combination of the pass's effects, each one also resolving the scene if the pass can
+    void submitEffect(ResourceManager& resourceManager, const EffectFile& file, int blurTaps = 0)
+    {
+        std::vector<std::string> features { file.features };
+        if (file.isFusable)
+            features.push_back("MSAA_RESOLVE");
+
+        // the base variant first, what a variant that fails to build falls back to
+        std::vector<std::vector<std::string>> combinations { {} };
+        for (unsigned mask { 1 }; mask < (1u << file.effects.size()); ++mask) {
+            std::vector<std::string> combination;
+            for (size_t i { 0 }; i < file.features.size(); ++i) {
+                if (mask & (1u << i))
+                    combination.push_back(file.features[i]);
+            }
+            if (!combination.empty())
+                combinations.push_back(combination);
+            if (file.isFusable) {
+                combination.push_back("MSAA_RESOLVE");
+                combinations.push_back(combination);
+            }
+        }
+
+        resourceManager.submitShaderVariants(file.pass, file.vertexShader, file.fragmentShader, features, combinations, getDefines(file, blurTaps));
+    }
 
-    void resetLevel(const ResourceManager& resourceManager)
+    size_t getRenderWidth() const { return std::max<size_t>(1, std::lround(m_framebufferWidth * m_resolution.getScale())); }
+
+    size_t getRenderHeight() const { return std::max<size_t>(1, std::lround(m_framebufferHeight * m_resolution.getScale())); }
+
+    void applyRenderScale()
     {
-        if (m_level == 0)
-            m_levels[0].load(resourceManager, "levels/one.lvl", m_width, m_height / 2);
-        else if (m_level == 1)
-            m_levels[1].load(resourceManager, "levels/two.lvl", m_width, m_height / 2);
-        else if (m_level == 2)
-            m_levels[2].load(resourceManager, "levels/three.lvl", m_width, m_height / 2);
-        else if (m_level == 3)
-            m_levels[3].load(resourceManager, "levels/four.lvl", m_width, m_height / 2);
+        if (m_effects->getRenderWidth() == getRenderWidth() && m_effects->getRenderHeight() == getRenderHeight())
+            return;
+        m_effects->setRenderSize(getRenderWidth(), getRenderHeight());
+        m_layerCache->resize(getRenderWidth(), getRenderHeight());
+        // draws the cached layers again in full
+        m_cachedLevel = m_levels.size();
     }
 
+    void resetLevel(const ResourceManager& resourceManager) { m_levels[m_level].load(resourceManager, m_levelFiles[m_level], m_width, m_height / 2); }
+
     void resetPlayer()
     {
         m_player->setSize(m_playerSize);
@@ -276,19 +485,21 @@ private:
     {
         auto bricks { m_levels[m_level].getBricks() };
 
-        for (auto& box : *bricks) {
+        for (size_t i { 0 }; i < bricks->size(); ++i) {
+            const GameObject& box { (*bricks)[i] };
+
             if (!box.getIsDestroyed()) {
                 Collision collision { checkCollision(*m_ball, box) };
 
                 if (collision.hasCollided) {
 
                     if (!box.getIsSolid()) {
-                        box.setIsDestroyed(true);
+                        m_levels[m_level].destroyBrick(i);
                         spawnPowerUps(box, resourceManager);
                     } else {
                         // enable shake effect
                         m_shakeTime = 0.05f;
-                        m_effects->setShake(true);
+                        m_effects->setEnabled("shake", true);
                     }
 
                     if (!(m_ball->getCanPassThrough() && !box.getIsSolid())) {
@@ -422,11 +633,11 @@ private:
                         }
                     } else if (powerUp.getType() == "confuse") {
                         if (!isOtherPowerUpActivated("confuse")) {
-                            m_effects->setConfuse(false);
+                            m_effects->setEnabled("confuse", false);
                         }
                     } else if (powerUp.getType() == "chaos") {
                         if (!isOtherPowerUpActivated("chaos")) {
-                            m_effects->setChaos(false);
+                            m_effects->setEnabled("chaos", false);
                         }
                     }
                 }
@@ -452,11 +663,11 @@ private:
         } else if (powerUp.getType() == "pad-size-increase") {
             m_player->setSizeX(m_player->getSizeX() + 50);
         } else if (powerUp.getType() == "confuse") {
-            if (!m_effects->getChaos())
-                m_effects->setConfuse(true);
+            if (!m_effects->isEnabled("chaos"))
+                m_effects->setEnabled("confuse", true);
         } else if (powerUp.getType() == "chaos") {
-            if (!m_effects->getConfuse())
-                m_effects->setChaos(true);
+            if (!m_effects->isEnabled("confuse"))
+                m_effects->setEnabled("chaos", true);
         }
     }
 
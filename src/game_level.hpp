@@ -1,22 +1,42 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
+#include <memory>
 #include <sstream>
+#include <utility>
 #include <vector>
 
 #include "game_object.hpp"
+#include "render_commands.hpp"
 #include "resource_manager.hpp"
+#include "static_sprite_batch.hpp"
+#include "tilemap.hpp"
+
+enum LevelRenderMode {
+    TilemapMode, // the tile grid in a texture, looked up per fragment by a single quad
+    InstancedMode // one static sprite instance per brick
+};
 
 class GameLevel {
 public:
-    GameLevel() { }
+    GameLevel()
+        : m_renderMode { TilemapMode }
+        , m_columns { 0 }
+        , m_rows { 0 }
+        , m_dirtyRegion { 0.0f }
+    {
+    }
 
     void load(const ResourceManager& resourceManager, const std::string& file, size_t levelWidth, size_t levelHeight)
     {
         m_bricks.clear();
+        m_cells.clear();
+        m_size = glm::vec2(levelWidth, levelHeight);
+        m_dirtyRegion = glm::vec4(0.0f, 0.0f, m_size);
 
         unsigned int tileCode;
-        GameLevel level;
         std::string line;
         std::ifstream fstream(file.c_str());
         std::vector<std::vector<size_t>> tileData;
@@ -35,14 +55,42 @@ public:
             if (!tileData.empty())
                 init(resourceManager, tileData, levelWidth, levelHeight);
         }
+
+        buildGeometry();
     }
 
-    void draw(SpriteRenderer& renderer)
+    // takes effect with the next load()
+    void setRenderMode(LevelRenderMode mode) { m_renderMode = mode; }
+
+    // the bricks were uploaded by load(), only bricks destroyed since the last frame are sent again
+    void draw(RenderCommandBuffer& commands)
     {
-        for (auto& tile : m_bricks) {
-            if (!tile.getIsDestroyed())
-                tile.draw(renderer);
-        }
+        if (m_tilemap)
+            commands.drawTilemap(LevelLayer, *m_tilemap);
+        else if (m_geometry)
+            commands.drawStaticSprites(LevelLayer, *m_geometry);
+    }
+
+    void destroyBrick(size_t index)
+    {
+        m_bricks[index].setIsDestroyed(true);
+        addDirtyRegion(glm::vec4(m_bricks[index].getPosition(), m_bricks[index].getSize()));
+
+        if (m_tilemap)
+            m_tilemap->setTile(m_cells[index].m_column, m_cells[index].m_row, 0);
+        else
+            m_geometry->setHidden(index, true);
+    }
+
+    // the area <vec2 position, vec2 size> that looks different since the last call
+    bool takeDirtyRegion(glm::vec4& region)
+    {
+        if (m_dirtyRegion.z <= 0.0f || m_dirtyRegion.w <= 0.0f)
+            return false;
+
+        region = m_dirtyRegion;
+        m_dirtyRegion = glm::vec4(0.0f);
+        return true;
     }
 
     bool isCompleted()
@@ -58,7 +106,19 @@ public:
     std::vector<GameObject>* getBricks() { return &m_bricks; }
 
 private:
+    struct Cell {
+        size_t m_column, m_row;
+        uint8_t m_code;
+    };
+
+    LevelRenderMode m_renderMode;
     std::vector<GameObject> m_bricks;
+    std::vector<Cell> m_cells; // where each brick is in the grid
+    size_t m_columns, m_rows;
+    glm::vec2 m_size;
+    glm::vec4 m_dirtyRegion;
+    std::unique_ptr<StaticSpriteBatch> m_geometry;
+    std::unique_ptr<Tilemap> m_tilemap;
 
     void init(const ResourceManager& resourceManager, std::vector<std::vector<size_t>> tileData, size_t levelWidth, size_t levelHeight)
     {
@@ -67,6 +127,8 @@ private:
         size_t width { tileData[0].size() };
         float unitWidth { levelWidth / static_cast<float>(width) };
         float unitHeight { levelHeight / static_cast<float>(height) };
+        m_columns = width;
+        m_rows = height;
 
         for (size_t y { 0 }; y < height; ++y) {
             for (size_t x { 0 }; x < width; ++x) {
@@ -78,6 +140,7 @@ private:
                     GameObject obj { pos, size, texture, glm::vec3(0.8f, 0.8f, 0.7f) };
                     obj.setIsSolid(true);
                     m_bricks.push_back(obj);
+                    m_cells.push_back(Cell { x, y, 1 });
                 } else if (tileData[y][x] > 1) {
                     glm::vec2 pos { unitWidth * x, unitHeight * y };
                     glm::vec2 size { unitWidth, unitHeight };
@@ -94,8 +157,54 @@ private:
                         color = glm::vec3(1.0f, 0.5f, 0.0f);
 
                     m_bricks.push_back(GameObject { pos, size, texture, color });
+                    m_cells.push_back(Cell { x, y, static_cast<uint8_t>(std::min<size_t>(tileData[y][x], MAX_TILE_CODES - 1)) });
                 }
             }
         }
     }
-};
+
+    void addDirtyRegion(glm::vec4 region)
+    {
+        if (m_dirtyRegion.z > 0.0f && m_dirtyRegion.w > 0.0f) {
+            glm::vec2 min { glm::min(glm::vec2(m_dirtyRegion), glm::vec2(region)) };
+            glm::vec2 max { glm::max(glm::vec2(m_dirtyRegion) + glm::vec2(m_dirtyRegion.z, m_dirtyRegion.w), glm::vec2(region) + glm::vec2(region.z, region.w)) };
+            region = glm::vec4(min, max - min);
+        }
+        m_dirtyRegion = region;
+    }
+
+    void buildGeometry()
+    {
+        m_geometry.reset();
+        m_tilemap.reset();
+
+        if (m_bricks.empty())
+            return;
+
+        // a tilemap samples every brick from the same texture
+        bool isTilemap { m_renderMode == TilemapMode };
+        for (const auto& brick : m_bricks)
+            isTilemap = isTilemap && brick.getSprite().getID() == m_bricks[0].getSprite().getID();
+
+        if (isTilemap) {
+            m_tilemap = std::make_unique<Tilemap>();
+            std::vector<uint8_t> codes(m_columns * m_rows, 0);
+
+            for (size_t i { 0 }; i < m_bricks.size(); ++i) {
+                const Cell& cell { m_cells[i] };
+                SpriteInstance instance { m_bricks[i].getInstance() };
+                codes[cell.m_row * m_columns + cell.m_column] = cell.m_code;
+                m_tilemap->setStyle(cell.m_code, glm::vec3(instance.m_color), instance.m_uvRect);
+            }
+
+            m_tilemap->build(m_columns, m_rows, codes, m_bricks[0].getSprite().getID(), glm::vec4(0.0f, 0.0f, m_size));
+        } else {
+            std::vector<std::pair<GLuint, SpriteInstance>> sprites;
+            for (const auto& brick : m_bricks)
+                sprites.push_back({ brick.getSprite().getID(), brick.getInstance() });
+
+            m_geometry = std::make_unique<StaticSpriteBatch>();
+            m_geometry->build(sprites);
+        }
+    }
+};
\ No newline at end of file
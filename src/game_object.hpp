@@ -3,6 +3,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "render_commands.hpp"
+#include "sprite_batch.hpp"
 #include "sprite_renderer.hpp"
 #include "texture.hpp"
 
@@ -36,6 +38,16 @@ public:
         renderer.drawSprite(m_sprite, m_position, m_size, m_rotation, m_color);
     }
 
+    void draw(SpriteBatch& batch)
+    {
+        batch.drawSprite(m_sprite, m_position, m_size, m_rotation, m_color);
+    }
+
+    void draw(RenderCommandBuffer& commands, SpriteLayer layer) const
+    {
+        commands.drawSprite(layer, m_sprite, m_position, m_size, m_rotation, m_color);
+    }
+
     void setIsSolid(bool isSolid) { m_isSolid = isSolid; }
 
     void setIsDestroyed(float isDestroyed) { m_isDestroyed = isDestroyed; }
@@ -58,6 +70,18 @@ public:
 
     void setColor(glm::vec3 color) { m_color = color; }
 
+    const Texture2D& getSprite() const { return m_sprite; }
+
+    // how the object is drawn this frame, as one sprite instance
+    SpriteInstance getInstance() const
+    {
+        SpriteInstance instance;
+        instance.m_rect = glm::vec4(m_position, m_size);
+        instance.m_uvRect = m_sprite.getUVRect();
+        instance.m_color = glm::vec4(m_color, glm::radians(m_rotation));
+        return instance;
+    }
+
     bool getIsSolid() const { return m_isSolid; }
 
     bool getIsDestroyed() const { return m_isDestroyed; }
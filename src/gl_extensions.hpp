@@ -0,0 +1,108 @@
+#pragma once
+
+#include <set>
+#include <string>
+
+#include <glad/glad.h>
+
+// entry points and enums newer than the 3.3 core profile glad was generated for
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void(APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void(APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void(APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void(APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// Optional GL features, resolved once after glad. Everything stays unavailable if load() is never called, so callers
+// always have to be ready to take the 3.3 path.
+class GLExtensions {
+public:
+    static GLExtensions& get()
+    {
+        static GLExtensions extensions;
+        return extensions;
+    }
+
+    void load(GLADloadproc loader)
+    {
+        GLint count { 0 };
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i { 0 }; i < count; ++i)
+            m_extensions.insert(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+
+        GLint major { 0 }, minor { 0 };
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        m_version = major * 10 + minor;
+
+        if (m_version >= 44 || has("GL_ARB_buffer_storage"))
+            m_bufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(loader("glBufferStorage"));
+
+        // a driver can support the entry points without offering any format to save in
+        GLint binaryFormats { 0 };
+        if (m_version >= 41 || has("GL_ARB_get_program_binary"))
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        if (binaryFormats > 0) {
+            m_getProgramBinary = reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(loader("glGetProgramBinary"));
+            m_programBinary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(loader("glProgramBinary"));
+            m_programParameteri = reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(loader("glProgramParameteri"));
+        }
+
+        // compiles and links run on driver threads, a status query is the only thing that waits for them
+        if (has("GL_KHR_parallel_shader_compile"))
+            m_maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(loader("glMaxShaderCompilerThreadsKHR"));
+        else if (has("GL_ARB_parallel_shader_compile"))
+            m_maxShaderCompilerThreads = reinterpret_cast<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC>(loader("glMaxShaderCompilerThreadsARB"));
+        if (m_maxShaderCompilerThreads != nullptr)
+            m_maxShaderCompilerThreads(0xffffffff); // as many as the driver likes
+    }
+
+    bool has(const std::string& extension) const { return m_extensions.count(extension) > 0; }
+
+    // as major * 10 + minor
+    int getVersion() const { return m_version; }
+
+    bool hasBufferStorage() const { return m_bufferStorage != nullptr; }
+
+    void bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) const { m_bufferStorage(target, size, data, flags); }
+
+    bool hasProgramBinary() const { return m_getProgramBinary != nullptr && m_programBinary != nullptr && m_programParameteri != nullptr; }
+
+    void getProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) const
+    {
+        m_getProgramBinary(program, bufSize, length, binaryFormat, binary);
+    }
+
+    void programBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) const { m_programBinary(program, binaryFormat, binary, length); }
+
+    void programParameteri(GLuint program, GLenum pname, GLint value) const { m_programParameteri(program, pname, value); }
+
+    bool hasParallelShaderCompile() const { return m_maxShaderCompilerThreads != nullptr; }
+
+private:
+    std::set<std::string> m_extensions;
+    int m_version { 33 };
+    PFNGLBUFFERSTORAGEPROC m_bufferStorage { nullptr };
+    PFNGLGETPROGRAMBINARYPROC m_getProgramBinary { nullptr };
+    PFNGLPROGRAMBINARYPROC m_programBinary { nullptr };
+    PFNGLPROGRAMPARAMETERIPROC m_programParameteri { nullptr };
+    PFNGLMAXSHADERCOMPILERTHREADSKHRPROC m_maxShaderCompilerThreads { nullptr };
+
+    GLExtensions() { }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+struct GpuPassStats {
+    std::string m_name;
+    double m_average; // milliseconds
+    double m_p99; // milliseconds
+    size_t m_samples;
+};
+
+// Measures GPU time per named pass with timestamp queries. Queries of a frame are only read back once the frame
+// comes round again in a ring of FRAMES, by which time the GPU has long finished them, so nothing ever waits.
+class GpuProfiler {
+public:
+    static constexpr size_t FRAMES { 4 };
+
+    // writes a summary to logFile every logInterval frames if a file is given
+    GpuProfiler(const std::string& logFile = "", size_t history = 300, size_t logInterval = 600)
+        : m_logFile { logFile }
+        , m_history { history }
+        , m_logInterval { logInterval }
+        , m_frame { 0 }
+        , m_dropped { 0 }
+        , m_openPass { -1 }
+        , m_frameTime { 0.0 }
+        , m_hasFrameTime { false }
+    {
+    }
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    ~GpuProfiler()
+    {
+        for (auto& frame : m_frames) {
+            if (!frame.m_queries.empty())
+                glDeleteQueries(frame.m_queries.size(), frame.m_queries.data());
+        }
+    }
+
+    void beginFrame()
+    {
+        Frame& frame { m_frames[m_frame % FRAMES] };
+        collect(frame);
+        frame.m_passes.clear();
+    }
+
+    // passes may not overlap, beginning one ends the one before
+    void beginPass(const std::string& name)
+    {
+        endPass();
+
+        auto it { m_passIndices.find(name) };
+        if (it == m_passIndices.end()) {
+            it = m_passIndices.emplace(name, m_passNames.size()).first;
+            m_passNames.push_back(name);
+            m_durations.emplace_back();
+        }
+
+        Frame& frame { m_frames[m_frame % FRAMES] };
+        size_t query { frame.m_passes.size() * 2 };
+        if (frame.m_queries.size() < query + 2) {
+            frame.m_queries.resize(query + 2);
+            glGenQueries(2, &frame.m_queries[query]);
+        }
+
+        glQueryCounter(frame.m_queries[query], GL_TIMESTAMP);
+        frame.m_passes.push_back(it->second);
+        m_openPass = it->second;
+    }
+
+    void endPass()
+    {
+        if (m_openPass < 0)
+            return;
+
+        Frame& frame { m_frames[m_frame % FRAMES] };
+        glQueryCounter(frame.m_queries[frame.m_passes.size() * 2 - 1], GL_TIMESTAMP);
+        m_openPass = -1;
+    }
+
+    void endFrame()
+    {
+        endPass();
+        ++m_frame;
+
+        if (!m_logFile.empty() && m_logInterval > 0 && m_frame % m_logInterval == 0) {
+            std::ofstream file { m_logFile };
+            log(file);
+        }
+    }
+
+    // in the order the passes were first seen
+    std::vector<GpuPassStats> getStats() const
+    {
+        std::vector<GpuPassStats> stats;
+
+        for (size_t i { 0 }; i < m_passNames.size(); ++i) {
+            const std::deque<double>& durations { m_durations[i] };
+            GpuPassStats pass { m_passNames[i], 0.0, 0.0, durations.size() };
+
+            if (!durations.empty()) {
+                std::vector<double> sorted { durations.begin(), durations.end() };
+                std::sort(sorted.begin(), sorted.end());
+                for (double duration : sorted)
+                    pass.m_average += duration;
+                pass.m_average /= sorted.size();
+                pass.m_p99 = sorted[static_cast<size_t>(std::ceil(0.99 * sorted.size())) - 1];
+            }
+
+            stats.push_back(pass);
+        }
+
+        return stats;
+    }
+
+    void log(std::ostream& stream) const
+    {
+        double total { 0.0 };
+        stream << std::left << std::setw(16) << "pass" << std::right << std::setw(12) << "avg ms" << std::setw(12) << "p99 ms"
+               << std::setw(10) << "samples" << "\n";
+
+        for (const auto& pass : getStats()) {
+            stream << std::left << std::setw(16) << pass.m_name << std::right << std::fixed << std::setprecision(3)
+                   << std::setw(12) << pass.m_average << std::setw(12) << pass.m_p99 << std::setw(10) << pass.m_samples << "\n";
+            total += pass.m_average;
+        }
+
+        stream << std::left << std::setw(16) << "total" << std::right << std::setw(12) << total << "\n"
+               << m_frame << " frames, " << m_dropped << " not ready in time" << std::endl;
+    }
+
+    size_t getFrameCount() const { return m_frame; }
+
+    // GPU time of all passes of the frame read back last, reported once per frame that was read back
+    bool takeFrameTime(double& milliseconds)
+    {
+        if (!m_hasFrameTime)
+            return false;
+        milliseconds = m_frameTime;
+        m_hasFrameTime = false;
+        return true;
+    }
+
+private:
+    struct Frame {
+        std::vector<GLuint> m_queries; // begin and end timestamp for each pass
+        std::vector<size_t> m_passes;
+    };
+
+    std::string m_logFile;
+    size_t m_history, m_logInterval;
+    size_t m_frame, m_dropped;
+    int m_openPass;
+    double m_frameTime;
+    bool m_hasFrameTime;
+    Frame m_frames[FRAMES];
+    std::map<std::string, size_t> m_passIndices;
+    std::vector<std::string> m_passNames;
+    std::vector<std::deque<double>> m_durations;
+
+    void collect(Frame& frame)
+    {
+        if (frame.m_passes.empty())
+            return;
+
+        // results arrive in order, if the last one is there all of them are
+        GLint isAvailable { 0 };
+        glGetQueryObjectiv(frame.m_queries[frame.m_passes.size() * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+        if (!isAvailable) {
+            ++m_dropped;
+            return;
+        }
+
+        m_frameTime = 0.0;
+        for (size_t i { 0 }; i < frame.m_passes.size(); ++i) {
+            GLuint64 begin { 0 }, end { 0 };
+            glGetQueryObjectui64v(frame.m_queries[i * 2], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.m_queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+
+            std::deque<double>& durations { m_durations[frame.m_passes[i]] };
+            durations.push_back((end - begin) / 1e6);
+            m_frameTime += durations.back();
+            if (durations.size() > m_history)
+                durations.pop_front();
+        }
+        m_hasFrameTime = true;
+    }
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_state.hpp"
+
+// Keeps the layers that rarely change (background and level) rendered in an offscreen framebuffer of the same size,
+// sample count and format as the scene, so a frame only has to blit them instead of drawing them. When something changes
+// only the region around it is drawn again.
+class LayerCache {
+public:
+    LayerCache(size_t width, size_t height, GLsizei samples, GLenum format)
+        : m_width { 0 }
+        , m_height { 0 }
+        , m_samples { samples }
+        , m_format { format }
+        , m_isRendering { false }
+    {
+        glGenFramebuffers(1, &m_frameBufferObject);
+        glGenRenderbuffers(1, &m_renderBufferObject);
+        resize(width, height);
+    }
+
+    LayerCache(const LayerCache&) = delete;
+    LayerCache& operator=(const LayerCache&) = delete;
+
+    ~LayerCache()
+    {
+        RenderState::get().deleteFramebuffer(m_frameBufferObject);
+        glDeleteRenderbuffers(1, &m_renderBufferObject);
+    }
+
+    // follows the size of the scene, what was cached is lost and has to be drawn again
+    void resize(size_t width, size_t height)
+    {
+        if (width == m_width && height == m_height)
+            return;
+        m_width = width;
+        m_height = height;
+
+        RenderState& state { RenderState::get() };
+        GLuint previous { state.getDrawFramebuffer() };
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObject);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderBufferObject);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, m_samples, m_format, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderBufferObject);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "ERROR::LAYER_CACHE: Failed to initialize FBO" << std::endl;
+        state.bindFramebuffer(GL_FRAMEBUFFER, previous);
+    }
+
+    // redirects drawing into the cache, clipped to region <vec2 position, vec2 size> in world units
+    void begin(glm::vec4 region, glm::vec2 worldSize)
+    {
+        RenderState& state { RenderState::get() };
+        m_target = state.getDrawFramebuffer();
+        m_isRendering = true;
+
+        // world space has y pointing down, window space up
+        const GLint* viewport { state.getViewport() };
+        glm::vec2 scale { viewport[2] / worldSize.x, viewport[3] / worldSize.y };
+        GLint left { viewport[0] + static_cast<GLint>(std::floor(region.x * scale.x)) };
+        GLint right { viewport[0] + static_cast<GLint>(std::ceil((region.x + region.z) * scale.x)) };
+        GLint bottom { viewport[1] + viewport[3] - static_cast<GLint>(std::ceil((region.y + region.w) * scale.y)) };
+        GLint top { viewport[1] + viewport[3] - static_cast<GLint>(std::floor(region.y * scale.y)) };
+
+        state.bindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObject);
+        state.enable(GL_SCISSOR_TEST);
+        state.scissor(left, bottom, std::max(right - left, 0), std::max(top - bottom, 0));
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    void end()
+    {
+        if (!m_isRendering)
+            return;
+
+        RenderState::get().disable(GL_SCISSOR_TEST);
+        RenderState::get().bindFramebuffer(GL_FRAMEBUFFER, m_target);
+        m_isRendering = false;
+    }
+
+    // copies the cached layers over everything in the bound framebuffer
+    void composite()
+    {
+        RenderState& state { RenderState::get() };
+        GLuint target { state.getDrawFramebuffer() };
+        state.bindFramebuffer(GL_READ_FRAMEBUFFER, m_frameBufferObject);
+        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        state.bindFramebuffer(GL_READ_FRAMEBUFFER, target);
+    }
+
+private:
+    size_t m_width, m_height;
+    GLsizei m_samples;
+    GLenum m_format;
+    bool m_isRendering;
+    GLuint m_frameBufferObject, m_renderBufferObject, m_target;
+};
@@ -2,14 +2,29 @@
 
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
 
+#include "file_watcher.hpp"
 #include "game.hpp"
+#include "gl_extensions.hpp"
+#include "program_cache.hpp"
+#include "render_state.hpp"
 #include "resource_manager.hpp"
 
 // settings
 const size_t screenWidth { 800 };
 const size_t screenHeight { 600 };
+const size_t headlessFrames { 600 };
+const float headlessTimeStep { 1.0f / 60.0f };
 
 Game game { screenWidth, screenHeight };
 ResourceManager resourceManager;
@@ -21,9 +36,23 @@ double lastY { screenHeight / 2.0f };
 
 void keyCallback(GLFWwindow* window, int key, int scanCode, int action, int mode);
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
+void runHeadless(GLFWwindow* window, size_t frames);
+void reloadChanges(FileWatcher& watcher);
 
-int main()
+int main(int argc, char** argv)
 {
+    // --headless [frames] renders offscreen and exits with timing statistics, for machines without a display build
+    // with ENGINE_HEADLESS so GLFW doesn't need one either
+    bool isHeadless { false };
+    size_t frames { headlessFrames };
+    for (int i { 1 }; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            isHeadless = true;
+            if (i + 1 < argc && std::atoi(argv[i + 1]) > 0)
+                frames = std::atoi(argv[++i]);
+        }
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -34,6 +63,12 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
     glfwWindowHint(GLFW_RESIZABLE, false);
+    // without alpha the window has the format of the scene, which can then be resolved straight into it
+    glfwWindowHint(GLFW_ALPHA_BITS, 0);
+    if (isHeadless) {
+        glfwWindowHint(GLFW_VISIBLE, false);
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+    }
 
     GLFWwindow* window = glfwCreateWindow(screenWidth, screenHeight, "OpenGL Game Engine", nullptr, nullptr);
     if (window == nullptr) {
@@ -49,14 +84,41 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return EXIT_FAILURE;
     }
+    GLExtensions::get().load((GLADloadproc)glfwGetProcAddress);
 
     glfwSetKeyCallback(window, keyCallback);
     glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    RenderState::get().enable(GL_BLEND);
+    RenderState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // linked programs are saved to the working directory, later starts skip compiling them
+    ProgramCache programCache { "shader_cache" };
+    resourceManager.setProgramCache(&programCache);
 
+    auto initStart { std::chrono::steady_clock::now() };
     game.init(resourceManager);
+    std::cout << "startup " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count() << " ms, "
+              << programCache.getHits() << " programs from the cache, " << programCache.getMisses() << " compiled"
+              << (programCache.isAvailable() ? "" : " (no program binary support)")
+              << (GLExtensions::get().hasParallelShaderCompile() ? ", in parallel" : "") << std::endl;
+
+    // on high DPI screens the framebuffer has more pixels than the window
+    int framebufferWidth, framebufferHeight;
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    framebufferSizeCallback(window, framebufferWidth, framebufferHeight);
+
+    if (isHeadless) {
+        runHeadless(window, frames);
+        resourceManager.clear();
+        glfwTerminate();
+        return EXIT_SUCCESS;
+    }
+
+    // shaders, textures and levels edited in the source tree are copied over the ones the game loaded and reloaded
+    FileWatcher watcher;
+    for (const char* directory : { "/shaders", "/res/textures", "/res/levels" })
+        watcher.watch(std::string { PROJECT_SOURCE_DIR } + directory);
 
     // timing
     float deltaTime { 0.0f }; // Time between current frame and last frame
@@ -69,6 +131,10 @@ int main()
         deltaTime = current_frame - lastFrame;
         lastFrame = current_frame;
 
+        if (watcher.hasChanges())
+            reloadChanges(watcher);
+        game.finishReloads(resourceManager);
+
         // input
         // -----
         game.processInput(deltaTime);
@@ -94,6 +160,73 @@ int main()
     return EXIT_SUCCESS;
 }
 
+void runHeadless(GLFWwindow* window, size_t frames)
+{
+    // fixed time step and the ball launched right away, so every run plays the same and breaks bricks
+    game.setKey(GLFW_KEY_SPACE, true);
+
+    std::vector<double> frameTimes;
+    auto start { std::chrono::steady_clock::now() };
+
+    for (size_t frame { 0 }; frame < frames; ++frame) {
+        auto frameStart { std::chrono::steady_clock::now() };
+
+        game.processInput(headlessTimeStep);
+        game.update(headlessTimeStep, resourceManager);
+
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+        game.render(resourceManager);
+        glfwSwapBuffers(window);
+
+        // nothing waits for the frame without a display, so it is finished here to be counted in full
+        glFinish();
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+    }
+
+    double seconds { std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+    std::sort(frameTimes.begin(), frameTimes.end());
+    auto percentile { [&frameTimes](double p) { return frameTimes[static_cast<size_t>(p * (frameTimes.size() - 1))]; } };
+
+    std::cout << glGetString(GL_RENDERER) << ", " << screenWidth << "x" << screenHeight << ", " << frames << " frames in " << seconds
+              << " s (" << frames / seconds << " fps)\n"
+              << "frame ms: min " << frameTimes.front() << ", median " << percentile(0.5) << ", p99 " << percentile(0.99)
+              << ", max " << frameTimes.back() << "\n"
+              << "render scale " << game.getRenderScale() << std::endl;
+    game.getProfiler().log(std::cout);
+}
+
+void reloadChanges(FileWatcher& watcher)
+{
+    // where the files of each watched directory are loaded from, relative to the working directory
+    const std::string source { PROJECT_SOURCE_DIR };
+    const std::pair<std::string, std::string> directories[] {
+        { source + "/shaders/", "" },
+        { source + "/res/textures/", "textures/" },
+        { source + "/res/levels/", "levels/" },
+    };
+
+    for (const auto& path : watcher.takeChanges()) {
+        for (const auto& directory : directories) {
+            if (path.compare(0, directory.first.size(), directory.first) != 0)
+                continue;
+
+            // only files the game has, editors also write backups and swap files
+            std::string file { directory.second + path.substr(directory.first.size()) };
+            std::error_code error;
+            if (!std::filesystem::exists(file, error))
+                continue;
+            if (!std::filesystem::equivalent(path, file, error))
+                std::filesystem::copy_file(path, file, std::filesystem::copy_options::overwrite_existing, error);
+            if (error) {
+                std::cerr << "ERROR::RELOAD: Failed to copy " << path << ": " << error.message() << std::endl;
+                continue;
+            }
+            game.reload(resourceManager, file);
+        }
+    }
+}
+
 void keyCallback(GLFWwindow* window, int key, int scanCode, int action, int mode)
 {
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
@@ -106,4 +239,10 @@ void keyCallback(GLFWwindow* window, int key, int scanCode, int action, int mode
     }
 }
 
-void framebufferSizeCallback(GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); }
+void framebufferSizeCallback(GLFWwindow* window, int width, int height)
+{
+    // minimized
+    if (width == 0 || height == 0)
+        return;
+    game.setFramebufferSize(width, height);
+}
@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "mesh.hpp"
+#include "render_state.hpp"
 #include "shader.hpp"
 
 struct Vertex {
@@ -30,16 +31,13 @@ public:
         }
 
         shader.setInt("material.diffuse", 0);
-        glBindTexture(GL_TEXTURE_2D, m_diffuseTexture.id);
+        RenderState::get().bindTexture(0, GL_TEXTURE_2D, m_diffuseTexture.id);
 
         shader.setInt("material.specular", 1);
-        glBindTexture(GL_TEXTURE_2D, m_specularTexture.id);
+        RenderState::get().bindTexture(1, GL_TEXTURE_2D, m_specularTexture.id);
 
-        glActiveTexture(GL_TEXTURE0);
-
-        glBindVertexArray(m_vertexArray);
+        RenderState::get().bindVertexArray(m_vertexArray);
         glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     }
 
     void load(const std::string& path, const std::string& directory)
@@ -139,8 +137,8 @@ private:
         glGenBuffers(1, &m_vertexBuffer);
         glGenBuffers(1, &m_elementBuffer);
 
-        glBindVertexArray(m_vertexArray);
-        glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+        RenderState::get().bindVertexArray(m_vertexArray);
+        RenderState::get().bindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
@@ -162,8 +160,6 @@ private:
         // vertex texture coords
         glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, textureCoordinates));
         glEnableVertexAttribArray(3);
-
-        glBindVertexArray(0);
     }
 
     unsigned int textureFromFile(const std::string& path, const std::string& directory)
@@ -183,7 +179,7 @@ private:
             else if (nrComponents == 4)
                 format = GL_RGBA;
 
-            glBindTexture(GL_TEXTURE_2D, textureID);
+            RenderState::get().bindTexture(0, GL_TEXTURE_2D, textureID);
             glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
             glGenerateMipmap(GL_TEXTURE_2D);
 
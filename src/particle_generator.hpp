@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <stddef.h>
 #include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
 #include "game_object.hpp"
+#include "render_commands.hpp"
+#include "render_state.hpp"
 #include "shader.hpp"
+#include "stream_buffer.hpp"
 #include "texture.hpp"
+#include "thread_pool.hpp"
 
 struct Particle {
     glm::vec2 m_position, m_velocity;
@@ -28,12 +34,18 @@ public:
     ParticleGenerator(Shader& shader, Texture2D& texture, size_t amount)
         : m_shader { shader }
         , m_texture { texture }
+        , m_instanceBuffer { GL_ARRAY_BUFFER, amount * sizeof(ParticleInstance) }
         , m_amount { amount }
         , m_lastUsedParticle { 0 }
+        , m_threadPool { nullptr }
     {
         init();
     }
 
+    // packs the live particles and copies recorded ones into the instance buffer on the pool's threads from now on,
+    // nullptr for the calling thread only
+    void setThreadPool(ThreadPool* pool) { m_threadPool = pool; }
+
     void update(float deltaTime, GameObject& object, size_t newParticles, glm::vec2 offset = glm::vec2(0.0f, 0.0f))
     {
         for (size_t i { 0 }; i < newParticles; ++i) {
@@ -54,28 +66,72 @@ public:
 
     void draw()
     {
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        size_t count { countLive() };
+        RenderState& state { RenderState::get() };
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE);
         m_shader.use();
+        m_texture.bind(0);
+        state.bindVertexArray(m_vertexArrayObject);
 
-        for (auto& particle : m_particles) {
-            if (particle.m_life > 0.0f) {
-                m_shader.setVec2("offset", particle.m_position);
-                m_shader.setVec4("color", particle.m_color);
-                m_texture.bind();
-                glBindVertexArray(m_vertexArrayObject);
-                glDrawArrays(GL_TRIANGLES, 0, 6);
-                glBindVertexArray(0);
-            }
+        if (count > 0) {
+            size_t offset;
+            packLive(static_cast<ParticleInstance*>(m_instanceBuffer.map(count * sizeof(ParticleInstance), offset)));
+            m_instanceBuffer.unmap();
+
+            state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.getID());
+            setInstanceAttributes(offset);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
         }
+        m_instanceBuffer.endFrame();
 
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    // draws particles that were recorded earlier with this generator's shader and texture
+    void draw(const ParticleInstance* particles, size_t count)
+    {
+        RenderState& state { RenderState::get() };
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE);
+        m_shader.use();
+        m_texture.bind(0);
+        state.bindVertexArray(m_vertexArrayObject);
+
+        if (count > 0) {
+            size_t offset;
+            ParticleInstance* instances { static_cast<ParticleInstance*>(m_instanceBuffer.map(count * sizeof(ParticleInstance), offset)) };
+            auto fill { [particles, instances](size_t begin, size_t end) { std::copy(particles + begin, particles + end, instances + begin); } };
+            if (m_threadPool)
+                m_threadPool->parallelFor(count, MIN_CHUNK, fill);
+            else
+                fill(0, count);
+            m_instanceBuffer.unmap();
+
+            state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.getID());
+            setInstanceAttributes(offset);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count);
+        }
+        m_instanceBuffer.endFrame();
+
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    void record(RenderCommandBuffer& commands, SpriteLayer layer)
+    {
+        size_t count { countLive() };
+        packLive(commands.drawParticles(layer, count));
     }
 
 private:
+    // particles per job, smaller counts aren't worth waking the workers for
+    static constexpr size_t MIN_CHUNK { 16384 };
+
     std::vector<Particle> m_particles;
+    std::vector<size_t> m_sliceStarts; // where the live particles of each slice go in the packed instances, and the total
     Shader m_shader;
     Texture2D m_texture;
+    StreamBuffer m_instanceBuffer;
     size_t m_amount, m_lastUsedParticle;
+    ThreadPool* m_threadPool;
     GLuint m_vertexArrayObject;
 
     void init()
@@ -93,17 +149,82 @@ private:
 
         glGenVertexArrays(1, &m_vertexArrayObject);
         glGenBuffers(1, &vertexBufferObject);
-        glBindVertexArray(m_vertexArrayObject);
+        RenderState::get().bindVertexArray(m_vertexArrayObject);
 
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+        RenderState::get().bindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
         glBufferData(GL_ARRAY_BUFFER, sizeof(particleQuad), particleQuad, GL_STATIC_DRAW);
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glBindVertexArray(0);
+
+        RenderState::get().bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.getID());
+        for (GLuint attribute { 1 }; attribute <= 2; ++attribute) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+        setInstanceAttributes(0);
 
         for (size_t i { 0 }; i < m_amount; ++i)
             m_particles.push_back(Particle {});
+
+        // the particle texture may be a region of an atlas page
+        m_shader.use();
+        m_shader.setVec4("uvRect", m_texture.getUVRect());
+    }
+
+    // expects the VAO and the instance buffer to be bound
+    void setInstanceAttributes(size_t offset)
+    {
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(offset + offsetof(ParticleInstance, m_position)));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)(offset + offsetof(ParticleInstance, m_color)));
+    }
+
+    // the particles are split into a few slices per thread; each slice is counted on its own, the counts are summed up
+    // into where every slice starts, then each one packs its live particles there, so no slice waits for another
+    size_t countLive()
+    {
+        size_t threads { m_threadPool ? m_threadPool->getThreadCount() : 1 };
+        size_t slices { std::max<size_t>(1, std::min(threads * 4, m_particles.size() / MIN_CHUNK)) };
+        m_sliceStarts.assign(slices + 1, 0);
+
+        forEachSlice([this](size_t slice, size_t begin, size_t end) {
+            size_t count { 0 };
+            for (size_t i { begin }; i < end; ++i)
+                count += m_particles[i].m_life > 0.0f;
+            m_sliceStarts[slice + 1] = count;
+        });
+
+        for (size_t slice { 0 }; slice < slices; ++slice)
+            m_sliceStarts[slice + 1] += m_sliceStarts[slice];
+        return m_sliceStarts.back();
+    }
+
+    // instances needs room for what countLive() returned
+    void packLive(ParticleInstance* instances) const
+    {
+        forEachSlice([this, instances](size_t slice, size_t begin, size_t end) {
+            ParticleInstance* next { instances + m_sliceStarts[slice] };
+            for (size_t i { begin }; i < end; ++i) {
+                const Particle& particle { m_particles[i] };
+                if (particle.m_life > 0.0f)
+                    *next++ = ParticleInstance { particle.m_position, particle.m_color };
+            }
+        });
+    }
+
+    // calls job(slice, begin, end) for the slices countLive() split the particles into
+    template <typename Job>
+    void forEachSlice(Job&& job) const
+    {
+        size_t slices { m_sliceStarts.size() - 1 };
+        auto run { [this, &job, slices](size_t first, size_t last) {
+            for (size_t slice { first }; slice < last; ++slice)
+                job(slice, slice * m_particles.size() / slices, (slice + 1) * m_particles.size() / slices);
+        } };
+        if (m_threadPool)
+            m_threadPool->parallelFor(slices, 1, run);
+        else
+            run(0, slices);
     }
 
     size_t firstUnusedParticle()
@@ -1,124 +1,362 @@
 #pragma once
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "gpu_profiler.hpp"
+#include "render_state.hpp"
+#include "render_target_pool.hpp"
 #include "shader.hpp"
-#include "sprite_renderer.hpp"
+#include "shader_variants.hpp"
 #include "texture.hpp"
 
+// One step of the post-processing chain: a full screen quad reading the output of the enabled pass before it from
+// texture unit 0 as "scene" and the size of a texel at its scale as "texelSize". A pass applies one or more effects,
+// each with a feature of its shaders, and draws with the variant built for the ones enabled, so combining effects
+// takes one pass rather than one each. An effect can also take several passes, like the two directions of a
+// separable blur, which are enabled together.
+struct EffectPass {
+    std::vector<std::string> m_effects; // feature i of m_shaders adds effect i, a pass of one effect needs none
+    std::string m_name; // also names its GPU time
+    // with an MSAA_RESOLVE feature, the variants with it read the multisampled scene when the pass comes first
+    ShaderVariants m_shaders;
+    GLenum m_inputFormat, m_outputFormat;
+    // of the output, relative to the render size; the last enabled pass draws to the screen, or below a scale of 1
+    // to a target of that size that is then blitted up
+    float m_scale;
+    unsigned m_enabled; // bit i for effect i, the pass is skipped without any
+};
+
+// Renders the scene into a multisampled target and takes it through the enabled effect passes, in the order they
+// were added, on its way to the default framebuffer. Intermediate results ping-pong between targets from a
+// RenderTargetPool; with no pass enabled the scene is resolved straight to the screen.
 class PostProcessor {
 public:
-    PostProcessor(Shader& shader, size_t width, size_t height)
-        : m_shader { shader }
-        , m_width { width }
-        , m_height { height }
-        , m_confuse { false }
-        , m_chaos { false }
-        , m_shake { false }
-    {
-        // initialize renderbuffer/framebuffer object
-        glGenFramebuffers(1, &m_multisampledFrameBufferObject);
-        glGenFramebuffers(1, &m_frameBufferObject);
-        glGenRenderbuffers(1, &m_renderBufferObject);
-
-        // initialize renderbuffer storage with a multisampled color buffer
-        glBindFramebuffer(GL_FRAMEBUFFER, m_multisampledFrameBufferObject);
-        glBindRenderbuffer(GL_RENDERBUFFER, m_renderBufferObject);
-        glRenderbufferStorageMultisample(GL_RENDERBUFFER, 4, GL_RGB, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderBufferObject);
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+    static constexpr GLsizei SAMPLES { 4 };
+    static constexpr GLenum SCENE_FORMAT { GL_RGB8 };
 
-        // initialize the FBO/texture to blit multisampeld color buffer
-        glBindFramebuffer(GL_FRAMEBUFFER, m_frameBufferObject);
-        m_texture.generate(width, height, nullptr);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture.getID(), 0);
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "ERROR::POSTPROCESSOR: Failed to initialize FBO" << std::endl;
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    PostProcessor(size_t width, size_t height)
+        : m_outputWidth { width }
+        , m_outputHeight { height }
+        , m_profiler { nullptr }
+        , m_input { nullptr }
+    {
+        checkScreenFormat();
+        setRenderSize(width, height);
 
-        // initialize render data and uniforms
+        // initialize render data
         initRenderData();
-        m_shader.use();
-        m_shader.setInt("scene", 0);
-        float offset { 1.0f / 300.0f };
-        float offsets[9][2] = {
-            { -offset, offset }, // top left
-            { 0.0f, offset }, // top center
-            { offset, offset }, // top right
-            { -offset, 0.0f }, // center left
-            { 0.0f, 0.0f }, // center center
-            { offset, 0.0f }, // center right
-            { -offset, -offset }, // bottom left
-            { 0.0f, -offset }, // bottom center
-            { offset, -offset } // bottom right
-        };
-        glUniform2fv(glGetUniformLocation(m_shader.getID(), "offsets"), 9, (float*)offsets);
-        int edgeKernel[9] = {
-            -1, -1, -1,
-            -1, 8, -1,
-            -1, -1, -1
-        };
-        glUniform1iv(glGetUniformLocation(m_shader.getID(), "edgeKernel"), 9, edgeKernel);
-        float blurKernel[9] = {
-            1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f,
-            2.0f / 16.0f, 4.0f / 16.0f, 2.0f / 16.0f,
-            1.0f / 16.0f, 2.0f / 16.0f, 1.0f / 16.0f
-        };
-        glUniform1fv(glGetUniformLocation(m_shader.getID(), "blurKernel"), 9, blurKernel);
     }
 
+    PostProcessor(const PostProcessor&) = delete;
+    PostProcessor& operator=(const PostProcessor&) = delete;
+
+    ~PostProcessor()
+    {
+        for (auto& target : m_targets)
+            deleteTarget(target);
+    }
+
+    // appends a pass of the effects to the chain, disabled; it has to read what everything before it can write
+    void addPass(const std::vector<std::string>& effects, const std::string& name, const ShaderVariants& shaders,
+        GLenum inputFormat = SCENE_FORMAT, GLenum outputFormat = SCENE_FORMAT, float scale = 1.0f)
+    {
+        bool isCompatible { inputFormat == SCENE_FORMAT };
+        for (const auto& pass : m_passes)
+            isCompatible = isCompatible && pass.m_outputFormat == inputFormat;
+        if (!isCompatible)
+            std::cerr << "ERROR::POSTPROCESSOR: Pass " << name << " can't read what the passes before it write" << std::endl;
+
+        m_passes.push_back(EffectPass { effects, name, ShaderVariants {}, inputFormat, outputFormat, scale, 0 });
+        setShaders(name, shaders);
+    }
+
+    // rebuilt shaders for the pass, the caller deletes the ones they replace
+    void setShaders(const std::string& name, const ShaderVariants& shaders)
+    {
+        EffectPass* pass { findPass(name) };
+        if (pass == nullptr)
+            return;
+
+        for (const auto& it : shaders.getVariants()) {
+            it.second.use();
+            it.second.setInt("scene", 0);
+        }
+        pass->m_shaders = shaders;
+    }
+
+    // every variant of the pass, for setting uniforms of their own
+    const ShaderVariants& getShaders(const std::string& name)
+    {
+        static const ShaderVariants none;
+        EffectPass* pass { findPass(name) };
+        return pass != nullptr ? pass->m_shaders : none;
+    }
+
+    // in all passes that apply the effect
+    void setEnabled(const std::string& effect, bool isEnabled)
+    {
+        for (auto& pass : m_passes) {
+            auto it { std::find(pass.m_effects.begin(), pass.m_effects.end(), effect) };
+            if (it == pass.m_effects.end())
+                continue;
+            unsigned bit { 1u << (it - pass.m_effects.begin()) };
+            pass.m_enabled = isEnabled ? pass.m_enabled | bit : pass.m_enabled & ~bit;
+        }
+    }
+
+    bool isEnabled(const std::string& effect) const
+    {
+        for (const auto& pass : m_passes) {
+            auto it { std::find(pass.m_effects.begin(), pass.m_effects.end(), effect) };
+            if (it != pass.m_effects.end())
+                return (pass.m_enabled & (1u << (it - pass.m_effects.begin()))) != 0;
+        }
+        return false;
+    }
+
+    bool isActive() const
+    {
+        return std::any_of(m_passes.begin(), m_passes.end(), [](const EffectPass& pass) { return pass.m_enabled != 0; });
+    }
+
+    // times each pass under its own name
+    void setProfiler(GpuProfiler* profiler) { m_profiler = profiler; }
+
+    // resolution the scene is rendered at, scaled to the output size by the chain; the targets of the last few sizes
+    // are kept, so going back and forth between two doesn't allocate every time
+    void setRenderSize(size_t width, size_t height)
+    {
+        for (size_t i { 0 }; i < m_targets.size(); ++i) {
+            if (m_targets[i].m_width == width && m_targets[i].m_height == height) {
+                std::rotate(m_targets.begin() + i, m_targets.begin() + i + 1, m_targets.end());
+                return;
+            }
+        }
+
+        if (m_targets.size() == POOL_SIZE) {
+            deleteTarget(m_targets.front());
+            m_targets.erase(m_targets.begin());
+        }
+        m_targets.push_back(createTarget(width, height));
+    }
+
+    void setOutputSize(size_t width, size_t height)
+    {
+        m_outputWidth = width;
+        m_outputHeight = height;
+    }
+
+    size_t getRenderWidth() const { return m_targets.back().m_width; }
+
+    size_t getRenderHeight() const { return m_targets.back().m_height; }
+
+    // intermediate targets of the chain
+    const RenderTargetPool& getTargetPool() const { return m_pool; }
+
     void beginRender()
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_multisampledFrameBufferObject);
+        m_pool.endFrame();
+
+        const SceneTarget& target { m_targets.back() };
+        RenderState::get().bindFramebuffer(GL_FRAMEBUFFER, target.m_multisampledFrameBufferObject);
+        RenderState::get().viewport(0, 0, target.m_width, target.m_height);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
     }
 
+    // with a pass enabled the scene is resolved for render(), unless the first pass does that itself; otherwise it
+    // goes straight to the default framebuffer and render() isn't needed
     void endRender()
     {
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_multisampledFrameBufferObject);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_frameBufferObject);
-        glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        const SceneTarget& target { m_targets.back() };
+        RenderState& state { RenderState::get() };
+
+        if (isActive()) {
+            // a fused shader fetches the nearest texel, so it only reads the scene at the size it draws; without one
+            // that linked the scene is resolved with a blit
+            const EffectPass& first { *std::find_if(m_passes.begin(), m_passes.end(), [](const EffectPass& pass) { return pass.m_enabled != 0; }) };
+            glm::uvec2 size { getOutputSize(first) };
+            bool canFuse { first.m_shaders.getBit("MSAA_RESOLVE") != 0 && first.m_shaders.isLinked(getVariant(first, true)) };
+            bool isFused { canFuse && size.x == target.m_width && size.y == target.m_height };
+            m_input = isFused ? nullptr : resolve(target);
+            state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+            return;
+        }
+
+        // a multisampled blit can only resolve to the same size and format
+        bool isDirect { m_canResolveToScreen && target.m_width == m_outputWidth && target.m_height == m_outputHeight };
+        RenderTarget* resolved { isDirect ? nullptr : resolve(target) };
+        state.bindFramebuffer(GL_READ_FRAMEBUFFER, isDirect ? target.m_multisampledFrameBufferObject : resolved->m_frameBufferObject);
+        state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        state.viewport(0, 0, m_outputWidth, m_outputHeight);
+        glBlitFramebuffer(0, 0, target.m_width, target.m_height, 0, 0, m_outputWidth, m_outputHeight, GL_COLOR_BUFFER_BIT,
+            isDirect ? GL_NEAREST : GL_LINEAR);
+        state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (resolved != nullptr)
+            m_pool.release(resolved);
     }
 
-    void render(float time)
+    // runs the enabled passes, time and the effect flags are read from FrameGlobals
+    void render()
     {
-        // set uniforms/options
-        m_shader.use();
-        m_shader.setFloat("time", time);
-        m_shader.setInt("confuse", m_confuse);
-        m_shader.setInt("chaos", m_chaos);
-        m_shader.setInt("shake", m_shake);
+        const SceneTarget& scene { m_targets.back() };
+        RenderState& state { RenderState::get() };
+        state.bindVertexArray(m_vertexArrayObject);
+
+        for (const auto& pass : m_passes) {
+            if (pass.m_enabled == 0)
+                continue;
+            if (m_profiler != nullptr)
+                m_profiler->beginPass(pass.m_name);
+
+            glm::uvec2 size { getOutputSize(pass) };
+            RenderTarget* output { isOnScreen(pass) ? nullptr : m_pool.acquire(size.x, size.y, pass.m_outputFormat) };
+            state.bindFramebuffer(GL_FRAMEBUFFER, output != nullptr ? output->m_frameBufferObject : 0);
+            state.viewport(0, 0, size.x, size.y);
+            if (output != nullptr)
+                glClear(GL_COLOR_BUFFER_BIT);
+
+            Shader shader { pass.m_shaders.get(getVariant(pass, m_input == nullptr)) };
+            shader.use();
+            shader.setVec2("texelSize", 1.0f / (glm::vec2(getRenderWidth(), getRenderHeight()) * pass.m_scale));
+            if (m_input == nullptr)
+                state.bindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, scene.m_multisampledTexture);
+            else
+                m_input->m_texture.bind(0);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
 
-        // render texture quad
-        glActiveTexture(GL_TEXTURE0);
-        m_texture.bind();
-        glBindVertexArray(m_vertexArrayObject);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+            if (m_input != nullptr)
+                m_pool.release(m_input);
+            m_input = output;
+        }
+
+        // a last pass at reduced scale
+        if (m_input != nullptr) {
+            state.bindFramebuffer(GL_READ_FRAMEBUFFER, m_input->m_frameBufferObject);
+            state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            state.viewport(0, 0, m_outputWidth, m_outputHeight);
+            glBlitFramebuffer(0, 0, m_input->m_width, m_input->m_height, 0, 0, m_outputWidth, m_outputHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+            m_pool.release(m_input);
+            m_input = nullptr;
+        }
     }
 
-    void setShake(bool isShaking) { m_shake = isShaking; }
+private:
+    static constexpr size_t POOL_SIZE { 3 };
+
+    // multisampled framebuffer the scene is drawn into
+    struct SceneTarget {
+        size_t m_width, m_height;
+        GLuint m_multisampledFrameBufferObject, m_multisampledTexture;
+    };
 
-    void setChaos(bool chaos) { m_chaos = chaos; }
+    std::vector<EffectPass> m_passes;
+    std::vector<SceneTarget> m_targets; // least recently used first, the current one last
+    RenderTargetPool m_pool;
+    size_t m_outputWidth, m_outputHeight;
+    bool m_canResolveToScreen;
+    GpuProfiler* m_profiler;
+    RenderTarget* m_input; // of the next pass, nullptr for the multisampled scene
+    GLuint m_vertexArrayObject;
 
-    void setConfuse(bool confuse) { m_confuse = confuse; }
+    EffectPass* findPass(const std::string& name)
+    {
+        for (auto& pass : m_passes) {
+            if (pass.m_name == name)
+                return &pass;
+        }
+        std::cerr << "ERROR::POSTPROCESSOR: No pass " << name << std::endl;
+        return nullptr;
+    }
 
-    bool getChaos() const { return m_chaos; }
+    bool isLast(const EffectPass& pass) const
+    {
+        auto next { m_passes.begin() + (&pass - m_passes.data()) + 1 };
+        return std::none_of(next, m_passes.end(), [](const EffectPass& other) { return other.m_enabled != 0; });
+    }
 
-    bool getConfuse() const { return m_confuse; }
+    // the features of the enabled effects, and MSAA_RESOLVE for reading the multisampled scene
+    static unsigned getVariant(const EffectPass& pass, bool isFused)
+    {
+        unsigned effects { (1u << std::min(pass.m_effects.size(), pass.m_shaders.getFeatures().size())) - 1 };
+        return (pass.m_enabled & effects) | (isFused ? pass.m_shaders.getBit("MSAA_RESOLVE") : 0);
+    }
 
-private:
-    Shader m_shader;
-    Texture2D m_texture;
-    size_t m_width, m_height;
-    bool m_confuse, m_chaos, m_shake;
-    GLuint m_multisampledFrameBufferObject, m_frameBufferObject, m_renderBufferObject, m_vertexArrayObject;
+    // a pass meant to work below full scale keeps doing so when it comes last
+    bool isOnScreen(const EffectPass& pass) const { return isLast(pass) && pass.m_scale >= 1.0f; }
+
+    glm::uvec2 getOutputSize(const EffectPass& pass) const
+    {
+        if (isOnScreen(pass))
+            return glm::uvec2(m_outputWidth, m_outputHeight);
+        return glm::uvec2(std::max<long>(1, std::lround(getRenderWidth() * pass.m_scale)),
+            std::max<long>(1, std::lround(getRenderHeight() * pass.m_scale)));
+    }
+
+    // blits the multisampled scene into a target from the pool, the caller releases it
+    RenderTarget* resolve(const SceneTarget& scene)
+    {
+        RenderTarget* target { m_pool.acquire(scene.m_width, scene.m_height, SCENE_FORMAT) };
+        RenderState& state { RenderState::get() };
+        state.bindFramebuffer(GL_READ_FRAMEBUFFER, scene.m_multisampledFrameBufferObject);
+        state.bindFramebuffer(GL_DRAW_FRAMEBUFFER, target->m_frameBufferObject);
+        glBlitFramebuffer(0, 0, scene.m_width, scene.m_height, 0, 0, scene.m_width, scene.m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        return target;
+    }
+
+    // the scene targets are SCENE_FORMAT, resolving them straight to the default framebuffer needs it to be the same
+    void checkScreenFormat()
+    {
+        GLboolean isDoubleBuffered { GL_FALSE };
+        glGetBooleanv(GL_DOUBLEBUFFER, &isDoubleBuffered);
+        GLenum attachment { static_cast<GLenum>(isDoubleBuffered ? GL_BACK_LEFT : GL_FRONT_LEFT) };
+
+        GLint red { 0 }, green { 0 }, blue { 0 }, alpha { 0 }, sampleBuffers { 0 };
+        RenderState::get().bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE, &red);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_GREEN_SIZE, &green);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_BLUE_SIZE, &blue);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alpha);
+        glGetIntegerv(GL_SAMPLE_BUFFERS, &sampleBuffers);
+        m_canResolveToScreen = red == 8 && green == 8 && blue == 8 && alpha == 0 && sampleBuffers == 0;
+    }
+
+    static SceneTarget createTarget(size_t width, size_t height)
+    {
+        SceneTarget target;
+        target.m_width = width;
+        target.m_height = height;
+        glGenFramebuffers(1, &target.m_multisampledFrameBufferObject);
+        glGenTextures(1, &target.m_multisampledTexture);
+
+        // a multisampled texture rather than a renderbuffer, so a fused shader can read it
+        RenderState& state { RenderState::get() };
+        state.bindFramebuffer(GL_FRAMEBUFFER, target.m_multisampledFrameBufferObject);
+        state.bindTexture(0, GL_TEXTURE_2D_MULTISAMPLE, target.m_multisampledTexture);
+        glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, SAMPLES, SCENE_FORMAT, width, height, GL_TRUE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, target.m_multisampledTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::POSTPROCESSOR: Failed to initialize MSFBO" << std::endl;
+        state.bindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        return target;
+    }
+
+    static void deleteTarget(SceneTarget& target)
+    {
+        RenderState& state { RenderState::get() };
+        state.deleteFramebuffer(target.m_multisampledFrameBufferObject);
+        state.deleteTexture(target.m_multisampledTexture);
+    }
 
     void initRenderData()
     {
@@ -137,13 +375,11 @@ private:
         glGenVertexArrays(1, &m_vertexArrayObject);
         glGenBuffers(1, &vertexBufferObject);
 
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
+        RenderState::get().bindBuffer(GL_ARRAY_BUFFER, vertexBufferObject);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-        glBindVertexArray(m_vertexArrayObject);
+        RenderState::get().bindVertexArray(m_vertexArrayObject);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gl_extensions.hpp"
+
+// Linked shader programs saved to disk with glGetProgramBinary, so a later start can skip compiling them. Files are
+// named after a hash of the program's sources and the driver that linked it; a driver update gives new names, and a
+// binary the driver still refuses is compiled again and overwritten. Needs a current context to be constructed.
+class ProgramCache {
+public:
+    // the directory is created with the first binary stored in it
+    ProgramCache(const std::string& directory)
+        : m_directory { directory }
+        , m_hits { 0 }
+        , m_misses { 0 }
+    {
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+            const GLubyte* value { glGetString(name) };
+            m_driver += value != nullptr ? reinterpret_cast<const char*>(value) : "";
+            m_driver += '\n';
+        }
+    }
+
+    bool isAvailable() const { return GLExtensions::get().hasProgramBinary(); }
+
+    uint64_t getKey(const std::vector<std::string>& sources) const
+    {
+        uint64_t hash { hashBytes(FNV_OFFSET, m_driver.data(), m_driver.size()) };
+        for (const auto& source : sources) {
+            hash = hashBytes(hash, source.data(), source.size());
+            hash = hashBytes(hash, "", 1); // keeps "ab" + "c" apart from "a" + "bc"
+        }
+        return hash;
+    }
+
+    // asks the driver to keep the binary of a program about to be linked
+    void prepare(GLuint program) const
+    {
+        if (isAvailable())
+            GLExtensions::get().programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // returns true if the program is linked from the stored binary, otherwise it still has to be compiled
+    bool load(uint64_t key, GLuint program)
+    {
+        ++m_misses;
+        if (!isAvailable())
+            return false;
+
+        std::ifstream file { getPath(key), std::ios::binary };
+        Header header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.m_magic != MAGIC || header.m_key != key)
+            return false;
+
+        // a truncated or damaged file can claim any length, it has to fit in what is left of it
+        std::error_code error;
+        uintmax_t size { std::filesystem::file_size(getPath(key), error) };
+        if (error || header.m_length <= 0 || static_cast<uintmax_t>(header.m_length) > size - sizeof(header))
+            return false;
+
+        std::vector<char> binary(header.m_length);
+        if (!file.read(binary.data(), binary.size()))
+            return false;
+
+        GLExtensions::get().programBinary(program, header.m_format, binary.data(), header.m_length);
+        GLint isLinked { GL_FALSE };
+        glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+        if (!isLinked)
+            return false;
+
+        --m_misses;
+        ++m_hits;
+        return true;
+    }
+
+    // after a successful link
+    void store(uint64_t key, GLuint program)
+    {
+        if (!isAvailable())
+            return;
+
+        GLint length { 0 };
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        Header header { MAGIC, key, GL_NONE, 0 };
+        std::vector<char> binary(length);
+        GLsizei written { 0 };
+        GLExtensions::get().getProgramBinary(program, length, &written, &header.m_format, binary.data());
+        header.m_length = written;
+
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+        std::ofstream file { getPath(key), std::ios::binary | std::ios::trunc };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), written);
+        if (!file)
+            std::cerr << "ERROR::PROGRAMCACHE: Failed to write " << getPath(key) << std::endl;
+    }
+
+    // programs loaded from a binary and ones that had to be compiled
+    size_t getHits() const { return m_hits; }
+
+    size_t getMisses() const { return m_misses; }
+
+private:
+    static constexpr uint32_t MAGIC { 0x4e494250 }; // "PBIN"
+    static constexpr uint64_t FNV_OFFSET { 14695981039346656037ull };
+    static constexpr uint64_t FNV_PRIME { 1099511628211ull };
+
+    struct Header {
+        uint32_t m_magic;
+        uint64_t m_key; // against a file renamed by hand
+        GLenum m_format;
+        GLsizei m_length;
+    };
+
+    std::string m_directory;
+    std::string m_driver; // vendor, renderer and version
+    size_t m_hits, m_misses;
+
+    // FNV-1a, unlike std::hash the same from one build to the next
+    static uint64_t hashBytes(uint64_t hash, const char* data, size_t size)
+    {
+        for (size_t i { 0 }; i < size; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    std::string getPath(uint64_t key) const
+    {
+        static const char* digits { "0123456789abcdef" };
+        std::string name(16, '0');
+        for (size_t i { 0 }; i < 16; ++i)
+            name[15 - i] = digits[(key >> (i * 4)) & 0xf];
+        return m_directory + "/" + name + ".bin";
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+// below this many items the passes over the histograms cost more than a comparison sort
+const size_t RADIX_SORT_MIN_SIZE { 256 };
+
+// Stable LSD radix sort on a 64-bit key, one byte per pass, ping-ponging between items and scratch. All eight
+// histograms are built in a single read, and bytes that are the same in every key skip their pass entirely, which
+// for keys whose low fields are mostly zero leaves only a few passes.
+template <typename T, typename GetKey>
+void radixSort(std::vector<T>& items, std::vector<T>& scratch, GetKey getKey)
+{
+    size_t count { items.size() };
+    if (count < RADIX_SORT_MIN_SIZE) {
+        std::stable_sort(items.begin(), items.end(), [&getKey](const T& a, const T& b) { return getKey(a) < getKey(b); });
+        return;
+    }
+
+    static thread_local size_t histograms[8][256];
+    std::fill(&histograms[0][0], &histograms[0][0] + 8 * 256, 0);
+    for (const T& item : items) {
+        uint64_t key { getKey(item) };
+        for (size_t digit { 0 }; digit < 8; ++digit)
+            ++histograms[digit][(key >> (digit * 8)) & 0xFF];
+    }
+
+    scratch.resize(count);
+    T* from { items.data() };
+    T* to { scratch.data() };
+    uint64_t firstKey { getKey(items[0]) };
+
+    for (size_t digit { 0 }; digit < 8; ++digit) {
+        size_t shift { digit * 8 };
+        size_t* histogram { histograms[digit] };
+        if (histogram[(firstKey >> shift) & 0xFF] == count)
+            continue;
+
+        size_t offset { 0 };
+        for (size_t bucket { 0 }; bucket < 256; ++bucket) {
+            size_t bucketSize { histogram[bucket] };
+            histogram[bucket] = offset;
+            offset += bucketSize;
+        }
+
+        for (size_t i { 0 }; i < count; ++i)
+            to[histogram[(getKey(from[i]) >> shift) & 0xFF]++] = from[i];
+        std::swap(from, to);
+    }
+
+    if (from != items.data())
+        items.swap(scratch);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+
+#include "frame_globals.hpp"
+#include "gpu_profiler.hpp"
+#include "layer_cache.hpp"
+#include "particle_generator.hpp"
+#include "post_processor.hpp"
+#include "render_commands.hpp"
+#include "shader.hpp"
+#include "sprite_batch.hpp"
+#include "static_sprite_batch.hpp"
+#include "tilemap.hpp"
+
+// Replays a recorded frame. This is the only place that turns commands into GL calls, so it is all that has to move
+// if submission gets its own thread.
+class RenderBackend {
+public:
+    RenderBackend(SpriteBatch& batch, Shader& staticSpriteShader, Shader& tilemapShader, ParticleGenerator& particles, PostProcessor& effects,
+        LayerCache& layerCache, FrameGlobals& frameGlobals)
+        : m_batch { batch }
+        , m_staticSpriteShader { staticSpriteShader }
+        , m_tilemapShader { tilemapShader }
+        , m_particles { particles }
+        , m_effects { effects }
+        , m_layerCache { layerCache }
+        , m_frameGlobals { frameGlobals }
+        , m_profiler { nullptr }
+        , m_pass { nullptr }
+        , m_isSkipping { false }
+    {
+        m_firstInstanceUniform = m_staticSpriteShader.getUniform<int>("firstInstance");
+        m_rectUniform = m_tilemapShader.getUniform<glm::vec4>("rect");
+        m_tileCountUniform = m_tilemapShader.getUniform<glm::vec2>("tileCount");
+    }
+
+    // times every pass of the following frames with profiler, nullptr to stop
+    void setProfiler(GpuProfiler* profiler)
+    {
+        m_profiler = profiler;
+        m_effects.setProfiler(profiler);
+    }
+
+    // expects the commands to be sorted
+    void execute(const RenderCommandBuffer& commands)
+    {
+        m_batch.begin();
+        m_pass = nullptr;
+
+        for (size_t i { 0 }; i < commands.size(); ++i) {
+            const RenderCommandHeader& command { commands.getCommand(i) };
+            beginPass(getPassName(command.m_key));
+
+            switch (command.m_type) {
+            case DrawSpriteCommand: {
+                if (m_isSkipping)
+                    break;
+                const DrawSprite& sprite { RenderCommandBuffer::getPayload<DrawSprite>(command) };
+                m_batch.setLayer(sprite.m_layer);
+                m_batch.drawSprite(sprite.m_texture, sprite.m_sprite);
+                break;
+            }
+            case DrawParticlesCommand: {
+                if (m_isSkipping)
+                    break;
+                // anything queued before has to end up below the particles
+                m_batch.flush();
+                const DrawParticles& particles { RenderCommandBuffer::getPayload<DrawParticles>(command) };
+                m_particles.draw(reinterpret_cast<const ParticleInstance*>(&particles + 1), particles.m_count);
+                break;
+            }
+            case DrawStaticSpritesCommand: {
+                if (m_isSkipping)
+                    break;
+                m_batch.flush();
+                const DrawStaticSprites& sprites { RenderCommandBuffer::getPayload<DrawStaticSprites>(command) };
+                StaticSpriteBatch::draw(m_staticSpriteShader, m_firstInstanceUniform, sprites.m_vertexArray, sprites.m_instanceBuffer,
+                    sprites.m_maskTexture, reinterpret_cast<const StaticSpriteRun*>(&sprites + 1), sprites.m_runCount);
+                break;
+            }
+            case DrawTilemapCommand:
+                if (m_isSkipping)
+                    break;
+                m_batch.flush();
+                Tilemap::draw(m_tilemapShader, m_rectUniform, m_tileCountUniform, RenderCommandBuffer::getPayload<TilemapDraw>(command));
+                break;
+            case UpdateTileCommand: {
+                const UpdateTile& update { RenderCommandBuffer::getPayload<UpdateTile>(command) };
+                Tilemap::updateTile(update.m_tiles, update.m_change);
+                break;
+            }
+            case UpdateBufferCommand: {
+                const UpdateBuffer& update { RenderCommandBuffer::getPayload<UpdateBuffer>(command) };
+                RenderState::get().bindBuffer(GL_COPY_WRITE_BUFFER, update.m_buffer);
+                glBufferSubData(GL_COPY_WRITE_BUFFER, update.m_offset, update.m_size, &update + 1);
+                break;
+            }
+            case SetEffectsCommand: {
+                const SetEffects& effects { RenderCommandBuffer::getPayload<SetEffects>(command) };
+                m_frameGlobals.setTime(effects.m_time);
+                m_frameGlobals.setEffects(effects.m_confuse, effects.m_chaos, effects.m_shake);
+                m_frameGlobals.upload();
+                break;
+            }
+            case BeginCachedLayersCommand: {
+                m_batch.flush();
+                glm::vec4 region { RenderCommandBuffer::getPayload<BeginCachedLayers>(command).m_region };
+                if (region.z > 0.0f && region.w > 0.0f)
+                    m_layerCache.begin(region, m_frameGlobals.getData().m_screenSize);
+                else
+                    m_isSkipping = true;
+                break;
+            }
+            case EndCachedLayersCommand:
+                m_batch.flush();
+                m_layerCache.end();
+                m_layerCache.composite();
+                m_isSkipping = false;
+                break;
+            case BeginPostProcessCommand:
+                m_batch.flush();
+                m_effects.beginRender();
+                break;
+            case EndPostProcessCommand:
+                m_batch.flush();
+                beginPass("resolve");
+                m_effects.endRender();
+                // each effect pass is timed on its own
+                if (m_effects.isActive())
+                    m_effects.render();
+                break;
+            default:
+                std::cerr << "ERROR::RENDER_BACKEND: Unknown command type " << command.m_type << std::endl;
+            }
+        }
+
+        m_batch.end();
+        if (m_profiler)
+            m_profiler->endPass();
+    }
+
+private:
+    SpriteBatch& m_batch;
+    Shader m_staticSpriteShader;
+    UniformHandle<int> m_firstInstanceUniform;
+    Shader m_tilemapShader;
+    UniformHandle<glm::vec4> m_rectUniform;
+    UniformHandle<glm::vec2> m_tileCountUniform;
+    ParticleGenerator& m_particles;
+    PostProcessor& m_effects;
+    LayerCache& m_layerCache;
+    FrameGlobals& m_frameGlobals;
+    GpuProfiler* m_profiler;
+    const char* m_pass;
+    bool m_isSkipping; // the cached layers are up to date, their draws can be dropped
+
+    static const char* getPassName(uint64_t key)
+    {
+        static const char* layerNames[] { "background", "level", "objects", "particles", "ball" };
+
+        uint8_t pass { static_cast<uint8_t>(key >> 56) };
+        if (pass == RenderCommandBuffer::SCENE_BEGIN_PASS)
+            return "clear";
+        if (pass == RenderCommandBuffer::SCENE_END_PASS)
+            return "resolve";
+        return layerNames[pass - RenderCommandBuffer::SPRITE_PASS];
+    }
+
+    void beginPass(const char* name)
+    {
+        if (!m_profiler || (m_pass && std::strcmp(name, m_pass) == 0))
+            return;
+
+        // sprites queued so far belong to the pass before
+        m_batch.flush();
+        m_profiler->beginPass(name);
+        m_pass = name;
+    }
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "radix_sort.hpp"
+#include "sprite_batch.hpp"
+#include "static_sprite_batch.hpp"
+#include "texture.hpp"
+#include "tilemap.hpp"
+
+enum RenderCommandType {
+    DrawSpriteCommand,
+    DrawParticlesCommand,
+    DrawStaticSpritesCommand,
+    DrawTilemapCommand,
+    UpdateBufferCommand,
+    UpdateTileCommand,
+    SetEffectsCommand,
+    BeginCachedLayersCommand,
+    EndCachedLayersCommand,
+    BeginPostProcessCommand,
+    EndPostProcessCommand
+};
+
+// where a command goes within its pass: updates and state before the draws, anything closing the pass after them
+enum RenderPhase {
+    SetupPhase,
+    DrawPhase,
+    TeardownPhase
+};
+
+// Commands are plain data and only refer to GL objects by name, so a frame can be recorded on one thread, handed
+// over, saved or replayed on another without touching the simulation.
+struct RenderCommandHeader {
+    uint32_t m_type;
+    uint32_t m_size; // bytes of payload following the header
+    uint64_t m_key;
+};
+
+struct DrawSprite {
+    GLuint m_texture;
+    SpriteLayer m_layer;
+    SpriteDraw m_sprite;
+};
+
+struct ParticleInstance {
+    glm::vec2 m_position;
+    glm::vec4 m_color;
+};
+
+// followed by m_count ParticleInstances
+struct DrawParticles {
+    uint32_t m_count;
+};
+
+// followed by m_runCount StaticSpriteRuns
+struct DrawStaticSprites {
+    GLuint m_vertexArray, m_instanceBuffer, m_maskTexture;
+    uint32_t m_runCount;
+};
+
+struct UpdateTile {
+    GLuint m_tiles;
+    TileChange m_change;
+};
+
+// followed by m_size bytes to copy to m_offset in m_buffer
+struct UpdateBuffer {
+    GLuint m_buffer;
+    uint32_t m_offset, m_size;
+};
+
+struct BeginCachedLayers {
+    glm::vec4 m_region; // <vec2 position, vec2 size> to draw again, empty if the cache is up to date
+};
+
+struct SetEffects {
+    float m_time;
+    GLint m_confuse, m_chaos, m_shake;
+};
+
+// Linear buffer of render commands for one frame. Every command carries a 64-bit sort key, most significant bits
+// first:
+//
+//     63-56  pass    55-54  phase    53  translucent
+//     opaque draws:       52-45  shader    44-29  texture    28-5  depth
+//     translucent draws:  52-29  depth     28-21  shader     20-5  texture
+//
+// Translucent draws go back to front and only then by state, opaque ones by state first. The shader is the draw
+// command's type, since each type has its own program. Commands with equal keys keep their recording order.
+class RenderCommandBuffer {
+public:
+    // passes in key order, sprite layers come between the start and the end of the post-processed scene
+    static const uint8_t SCENE_BEGIN_PASS { 0 };
+    static const uint8_t SPRITE_PASS { 1 };
+    static const uint8_t SCENE_END_PASS { 0xFF };
+
+    void clear()
+    {
+        m_data.clear();
+        m_entries.clear();
+    }
+
+    // depth orders sprites within the layer, from 1 at the back to 0 at the front
+    void drawSprite(SpriteLayer layer, const Texture2D& texture, glm::vec2 position, glm::vec2 size, float rotation, glm::vec3 color,
+        float depth = 0.0f)
+    {
+        uint64_t key { makeDrawKey(SPRITE_PASS + layer, texture.hasAlpha(), DrawSpriteCommand, texture.getID(), depth) };
+        DrawSprite* command { push<DrawSprite>(DrawSpriteCommand, key) };
+        command->m_texture = texture.getID();
+        command->m_layer = layer;
+        command->m_sprite = SpriteDraw { position, size, texture.getUVRect(), color, rotation };
+    }
+
+    // returns the space for the particles, to be filled by the caller before anything else is recorded
+    ParticleInstance* drawParticles(SpriteLayer layer, size_t count)
+    {
+        DrawParticles* command { push<DrawParticles>(DrawParticlesCommand, makeDrawKey(SPRITE_PASS + layer, true, DrawParticlesCommand, 0, 0.0f),
+            count * sizeof(ParticleInstance)) };
+        command->m_count = static_cast<uint32_t>(count);
+        return reinterpret_cast<ParticleInstance*>(command + 1);
+    }
+
+    // also records the changes to the batch's mask since the last time it was drawn
+    void drawStaticSprites(SpriteLayer layer, StaticSpriteBatch& batch)
+    {
+        size_t offset, size;
+        if (batch.takeDirtyRange(offset, size)) {
+            UpdateBuffer* update { push<UpdateBuffer>(UpdateBufferCommand, makeKey(SPRITE_PASS + layer, SetupPhase), size) };
+            update->m_buffer = batch.getMaskBuffer();
+            update->m_offset = static_cast<uint32_t>(offset);
+            update->m_size = static_cast<uint32_t>(size);
+            std::memcpy(update + 1, batch.getMask() + offset, size);
+        }
+
+        const std::vector<StaticSpriteRun>& runs { batch.getRuns() };
+        uint64_t key { makeDrawKey(SPRITE_PASS + layer, false, DrawStaticSpritesCommand, runs.empty() ? 0 : runs[0].m_texture, 0.0f) };
+        DrawStaticSprites* command { push<DrawStaticSprites>(DrawStaticSpritesCommand, key, runs.size() * sizeof(StaticSpriteRun)) };
+        command->m_vertexArray = batch.getVertexArray();
+        command->m_instanceBuffer = batch.getInstanceBuffer();
+        command->m_maskTexture = batch.getMaskTexture();
+        command->m_runCount = static_cast<uint32_t>(runs.size());
+        std::copy(runs.begin(), runs.end(), reinterpret_cast<StaticSpriteRun*>(command + 1));
+    }
+
+    // also records the tiles changed since the last time it was drawn
+    void drawTilemap(SpriteLayer layer, Tilemap& tilemap)
+    {
+        for (const auto& change : tilemap.getChanges()) {
+            UpdateTile* update { push<UpdateTile>(UpdateTileCommand, makeKey(SPRITE_PASS + layer, SetupPhase)) };
+            update->m_tiles = tilemap.getTiles();
+            update->m_change = change;
+        }
+        tilemap.clearChanges();
+
+        uint64_t key { makeDrawKey(SPRITE_PASS + layer, false, DrawTilemapCommand, tilemap.getDraw().m_texture, 0.0f) };
+        *push<TilemapDraw>(DrawTilemapCommand, key) = tilemap.getDraw();
+    }
+
+    void setEffects(float time, bool confuse, bool chaos, bool shake)
+    {
+        SetEffects* command { push<SetEffects>(SetEffectsCommand, makeKey(SCENE_BEGIN_PASS, SetupPhase)) };
+        command->m_time = time;
+        command->m_confuse = confuse;
+        command->m_chaos = chaos;
+        command->m_shake = shake;
+    }
+
+    // layers from this one up to endCachedLayers() are drawn into the layer cache, and only inside region
+    void beginCachedLayers(SpriteLayer layer, glm::vec4 region)
+    {
+        push<BeginCachedLayers>(BeginCachedLayersCommand, makeKey(SPRITE_PASS + layer, SetupPhase))->m_region = region;
+    }
+
+    void endCachedLayers(SpriteLayer layer) { push<uint32_t>(EndCachedLayersCommand, makeKey(SPRITE_PASS + layer, TeardownPhase)); }
+
+    void beginPostProcess() { push<uint32_t>(BeginPostProcessCommand, makeKey(SCENE_BEGIN_PASS, SetupPhase)); }
+
+    void endPostProcess() { push<uint32_t>(EndPostProcessCommand, makeKey(SCENE_END_PASS, SetupPhase)); }
+
+    // orders the commands by key; commands with equal keys keep their recording order
+    void sort()
+    {
+        radixSort(m_entries, m_scratch, [](const Entry& entry) { return entry.m_key; });
+    }
+
+    size_t size() const { return m_entries.size(); }
+
+    const RenderCommandHeader& getCommand(size_t index) const
+    {
+        return *reinterpret_cast<const RenderCommandHeader*>(m_data.data() + m_entries[index].m_offset);
+    }
+
+    template <typename T>
+    static const T& getPayload(const RenderCommandHeader& header)
+    {
+        return *reinterpret_cast<const T*>(&header + 1);
+    }
+
+    // the recorded frame as raw bytes, in recording order
+    const std::vector<unsigned char>& getData() const { return m_data; }
+
+    static uint64_t makeKey(uint8_t pass, RenderPhase phase) { return static_cast<uint64_t>(pass) << 56 | static_cast<uint64_t>(phase) << 54; }
+
+    static uint64_t makeDrawKey(uint8_t pass, bool isTranslucent, uint8_t shader, GLuint texture, float depth)
+    {
+        uint64_t distance { static_cast<uint64_t>((1.0f - glm::clamp(depth, 0.0f, 1.0f)) * 0xFFFFFF) };
+        uint64_t state { static_cast<uint64_t>(shader) << 16 | (texture & 0xFFFF) };
+        uint64_t key { makeKey(pass, DrawPhase) };
+        if (isTranslucent)
+            return key | 1ull << 53 | distance << 29 | state << 5;
+        return key | state << 29 | distance << 5;
+    }
+
+private:
+    struct Entry {
+        uint64_t m_key;
+        size_t m_offset;
+    };
+
+    // headers and payloads stay 16 byte aligned so they can be read in place
+    static const size_t ALIGNMENT { 16 };
+
+    std::vector<unsigned char> m_data;
+    std::vector<Entry> m_entries, m_scratch;
+
+    template <typename T>
+    T* push(RenderCommandType type, uint64_t key, size_t extra = 0)
+    {
+        static_assert(sizeof(RenderCommandHeader) % ALIGNMENT == 0, "payloads must start aligned");
+
+        size_t size { sizeof(T) + extra };
+        size_t offset { m_data.size() };
+        m_data.resize(offset + sizeof(RenderCommandHeader) + (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+
+        RenderCommandHeader header { static_cast<uint32_t>(type), static_cast<uint32_t>(size), key };
+        std::memcpy(m_data.data() + offset, &header, sizeof(header));
+        m_entries.push_back(Entry { header.m_key, offset });
+
+        return reinterpret_cast<T*>(m_data.data() + offset + sizeof(RenderCommandHeader));
+    }
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+
+#include <glad/glad.h>
+
+struct RenderStateStats {
+    size_t m_issued; // calls that reached GL
+    size_t m_skipped; // calls filtered because they would not have changed anything
+};
+
+// Shadow of the GL state the engine touches. Every bind goes through here so calls that would not change anything
+// never reach the driver. Objects must be deleted through it as well, otherwise a recycled name could be mistaken
+// for one that is still bound.
+class RenderState {
+public:
+    static RenderState& get()
+    {
+        static RenderState state;
+        return state;
+    }
+
+    // forget everything, for when GL state was changed behind our back
+    void invalidate()
+    {
+        m_program = UNKNOWN;
+        m_activeTexture = UNKNOWN;
+        std::fill(m_textures, m_textures + MAX_TEXTURE_UNITS, UNKNOWN);
+        m_vertexArray = UNKNOWN;
+        m_arrayBuffer = UNKNOWN;
+        m_uniformBuffer = UNKNOWN;
+        m_readFramebuffer = UNKNOWN;
+        m_drawFramebuffer = UNKNOWN;
+        m_blendSource = UNKNOWN;
+        m_blendDestination = UNKNOWN;
+        m_viewport[0] = m_viewport[1] = m_viewport[2] = m_viewport[3] = -1;
+        m_scissor[0] = m_scissor[1] = m_scissor[2] = m_scissor[3] = -1;
+        m_capabilities.clear();
+    }
+
+    void useProgram(GLuint program)
+    {
+        if (change(m_program, program))
+            glUseProgram(program);
+    }
+
+    // leaves the unit active, so glTex* calls that follow always edit this texture
+    void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        setActiveTexture(unit);
+
+        if (unit >= MAX_TEXTURE_UNITS) {
+            glBindTexture(target, texture);
+            ++m_stats.m_issued;
+            return;
+        }
+
+        if (change(m_textures[unit], texture))
+            glBindTexture(target, texture);
+    }
+
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (change(m_vertexArray, vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    // array and uniform buffer bindings are tracked, anything else goes straight through
+    void bindBuffer(GLenum target, GLuint buffer)
+    {
+        if (target == GL_ARRAY_BUFFER) {
+            if (change(m_arrayBuffer, buffer))
+                glBindBuffer(target, buffer);
+        } else if (target == GL_UNIFORM_BUFFER) {
+            if (change(m_uniformBuffer, buffer))
+                glBindBuffer(target, buffer);
+        } else {
+            glBindBuffer(target, buffer);
+            ++m_stats.m_issued;
+        }
+    }
+
+    // binding a range of an indexed target also replaces the generic binding
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+    {
+        glBindBufferBase(target, index, buffer);
+        ++m_stats.m_issued;
+
+        if (target == GL_UNIFORM_BUFFER)
+            m_uniformBuffer = buffer;
+    }
+
+    void bindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        bool isRead { target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER };
+        bool isDraw { target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER };
+
+        if ((isRead && m_readFramebuffer != framebuffer) || (isDraw && m_drawFramebuffer != framebuffer)) {
+            glBindFramebuffer(target, framebuffer);
+            ++m_stats.m_issued;
+
+            if (isRead)
+                m_readFramebuffer = framebuffer;
+            if (isDraw)
+                m_drawFramebuffer = framebuffer;
+        } else {
+            ++m_stats.m_skipped;
+        }
+    }
+
+    void blendFunc(GLenum source, GLenum destination)
+    {
+        if (m_blendSource != source || m_blendDestination != destination) {
+            glBlendFunc(source, destination);
+            ++m_stats.m_issued;
+            m_blendSource = source;
+            m_blendDestination = destination;
+        } else {
+            ++m_stats.m_skipped;
+        }
+    }
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (m_viewport[0] != x || m_viewport[1] != y || m_viewport[2] != width || m_viewport[3] != height) {
+            glViewport(x, y, width, height);
+            ++m_stats.m_issued;
+            m_viewport[0] = x;
+            m_viewport[1] = y;
+            m_viewport[2] = width;
+            m_viewport[3] = height;
+        } else {
+            ++m_stats.m_skipped;
+        }
+    }
+
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        if (m_scissor[0] != x || m_scissor[1] != y || m_scissor[2] != width || m_scissor[3] != height) {
+            glScissor(x, y, width, height);
+            ++m_stats.m_issued;
+            m_scissor[0] = x;
+            m_scissor[1] = y;
+            m_scissor[2] = width;
+            m_scissor[3] = height;
+        } else {
+            ++m_stats.m_skipped;
+        }
+    }
+
+    // <x, y, width, height>, asks GL if it wasn't set through here
+    const GLint* getViewport()
+    {
+        if (m_viewport[2] < 0)
+            glGetIntegerv(GL_VIEWPORT, m_viewport);
+        return m_viewport;
+    }
+
+    GLuint getDrawFramebuffer()
+    {
+        if (m_drawFramebuffer == UNKNOWN) {
+            GLint framebuffer { 0 };
+            glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+            m_drawFramebuffer = framebuffer;
+        }
+        return m_drawFramebuffer;
+    }
+
+    void enable(GLenum capability) { setEnabled(capability, true); }
+
+    void disable(GLenum capability) { setEnabled(capability, false); }
+
+    void setEnabled(GLenum capability, bool isEnabled)
+    {
+        auto it { m_capabilities.find(capability) };
+        if (it != m_capabilities.end() && it->second == isEnabled) {
+            ++m_stats.m_skipped;
+            return;
+        }
+
+        if (isEnabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        ++m_stats.m_issued;
+        m_capabilities[capability] = isEnabled;
+    }
+
+    void deleteProgram(GLuint program)
+    {
+        if (m_program == program)
+            m_program = UNKNOWN;
+        glDeleteProgram(program);
+    }
+
+    void deleteTexture(GLuint texture)
+    {
+        // deleting a bound texture reverts its units to 0
+        for (auto& bound : m_textures) {
+            if (bound == texture)
+                bound = 0;
+        }
+        glDeleteTextures(1, &texture);
+    }
+
+    void deleteVertexArray(GLuint vertexArray)
+    {
+        if (m_vertexArray == vertexArray)
+            m_vertexArray = 0;
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+
+    void deleteBuffer(GLuint buffer)
+    {
+        if (m_arrayBuffer == buffer)
+            m_arrayBuffer = 0;
+        if (m_uniformBuffer == buffer)
+            m_uniformBuffer = 0;
+        glDeleteBuffers(1, &buffer);
+    }
+
+    void deleteFramebuffer(GLuint framebuffer)
+    {
+        if (m_readFramebuffer == framebuffer)
+            m_readFramebuffer = 0;
+        if (m_drawFramebuffer == framebuffer)
+            m_drawFramebuffer = 0;
+        glDeleteFramebuffers(1, &framebuffer);
+    }
+
+    const RenderStateStats& getStats() const { return m_stats; }
+
+    void resetStats() { m_stats = RenderStateStats {}; }
+
+private:
+    static constexpr GLuint UNKNOWN { 0xFFFFFFFF };
+    static constexpr GLuint MAX_TEXTURE_UNITS { 16 };
+
+    GLuint m_program;
+    GLuint m_activeTexture;
+    GLuint m_textures[MAX_TEXTURE_UNITS];
+    GLuint m_vertexArray, m_arrayBuffer, m_uniformBuffer;
+    GLuint m_readFramebuffer, m_drawFramebuffer;
+    GLenum m_blendSource, m_blendDestination;
+    GLint m_viewport[4], m_scissor[4];
+    std::map<GLenum, bool> m_capabilities;
+    RenderStateStats m_stats;
+
+    RenderState()
+        : m_stats {}
+    {
+        invalidate();
+    }
+
+    bool change(GLuint& cached, GLuint value)
+    {
+        if (cached == value) {
+            ++m_stats.m_skipped;
+            return false;
+        }
+
+        cached = value;
+        ++m_stats.m_issued;
+        return true;
+    }
+
+    void setActiveTexture(GLuint unit)
+    {
+        if (change(m_activeTexture, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+};
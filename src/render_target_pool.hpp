@@ -0,0 +1,122 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "render_state.hpp"
+#include "texture.hpp"
+
+// a single sampled texture and the framebuffer drawing into it
+struct RenderTarget {
+    size_t m_width, m_height;
+    GLenum m_format;
+    GLuint m_frameBufferObject;
+    Texture2D m_texture;
+};
+
+// Hands out render targets for the intermediate results of a frame. A released target goes back to the pool and
+// the next request for the same size and format gets it again, later in the frame or in one of the next; targets
+// nobody asked for in MAX_IDLE_FRAMES are deleted, so sizes left behind by a resolution change don't stay around.
+class RenderTargetPool {
+public:
+    static constexpr size_t MAX_IDLE_FRAMES { 120 };
+
+    RenderTargetPool()
+        : m_frame { 0 }
+    {
+    }
+
+    RenderTargetPool(const RenderTargetPool&) = delete;
+    RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+    ~RenderTargetPool()
+    {
+        for (auto& entry : m_entries)
+            destroy(entry->m_target);
+    }
+
+    // the target stays valid until it is released
+    RenderTarget* acquire(size_t width, size_t height, GLenum format)
+    {
+        for (auto& entry : m_entries) {
+            const RenderTarget& target { entry->m_target };
+            if (!entry->m_isUsed && target.m_width == width && target.m_height == height && target.m_format == format) {
+                entry->m_isUsed = true;
+                entry->m_lastUsed = m_frame;
+                return &entry->m_target;
+            }
+        }
+
+        m_entries.push_back(std::make_unique<Entry>());
+        Entry& entry { *m_entries.back() };
+        entry.m_isUsed = true;
+        entry.m_lastUsed = m_frame;
+        create(entry.m_target, width, height, format);
+        return &entry.m_target;
+    }
+
+    void release(RenderTarget* target)
+    {
+        for (auto& entry : m_entries) {
+            if (&entry->m_target == target)
+                entry->m_isUsed = false;
+        }
+    }
+
+    void endFrame()
+    {
+        ++m_frame;
+
+        for (size_t i { 0 }; i < m_entries.size();) {
+            if (!m_entries[i]->m_isUsed && m_frame - m_entries[i]->m_lastUsed > MAX_IDLE_FRAMES) {
+                destroy(m_entries[i]->m_target);
+                m_entries.erase(m_entries.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    size_t getCount() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        RenderTarget m_target;
+        bool m_isUsed;
+        size_t m_lastUsed; // frame
+    };
+
+    std::vector<std::unique_ptr<Entry>> m_entries; // targets handed out keep their address
+    size_t m_frame;
+
+    static void create(RenderTarget& target, size_t width, size_t height, GLenum format)
+    {
+        target.m_width = width;
+        target.m_height = height;
+        target.m_format = format;
+
+        // effects read around the edges, wrapping like the scene always did
+        bool hasAlpha { format == GL_RGBA || format == GL_RGBA8 || format == GL_RGBA16F || format == GL_RGBA32F };
+        target.m_texture.setInternalFormat(format);
+        target.m_texture.setImageFormat(hasAlpha ? GL_RGBA : GL_RGB);
+        target.m_texture.generate(width, height, nullptr);
+
+        RenderState& state { RenderState::get() };
+        GLuint previous { state.getDrawFramebuffer() };
+        glGenFramebuffers(1, &target.m_frameBufferObject);
+        state.bindFramebuffer(GL_FRAMEBUFFER, target.m_frameBufferObject);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.m_texture.getID(), 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "ERROR::RENDER_TARGET_POOL: Failed to initialize FBO" << std::endl;
+        state.bindFramebuffer(GL_FRAMEBUFFER, previous);
+    }
+
+    static void destroy(RenderTarget& target)
+    {
+        RenderState::get().deleteFramebuffer(target.m_frameBufferObject);
+        target.m_texture.deleteTexture();
+    }
+};
@@ -4,84 +4,296 @@
 
 #include <fstream>
 #include <map>
-#include <sstream>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <stb_image.h>
 
 #include "shader.hpp"
+#include "shader_variants.hpp"
 #include "texture.hpp"
+#include "texture_atlas.hpp"
+
+struct TextureFile {
+    std::string file;
+    bool hasAlpha;
+    std::string name;
+};
+
+// what a shader was built from, to build it again when one of its files changes
+struct ShaderSource {
+    std::string vertexFile, fragmentFile, geometryFile;
+    std::vector<std::string> defines;
+    std::set<std::string> files; // includes too
+    Shader shader;
+};
 
 class ResourceManager {
 public:
     ResourceManager() { }
 
-    Shader loadShader(const std::string& name, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& geometryShaderFile = "")
+    // defines like "NAME" or "NAME value" are added to every stage right after its #version line
+    Shader loadShader(const std::string& name, const std::string& vertexShaderFile, const std::string& fragmentShaderFile, const std::string& geometryShaderFile = "",
+        const std::vector<std::string>& defines = {})
     {
-        m_shaders[name] = loadShaderFromFile(vertexShaderFile, fragmentShaderFile, geometryShaderFile);
+        m_shaders[name] = addShaderSource(name, vertexShaderFile, fragmentShaderFile, geometryShaderFile, defines);
+        m_shaders[name].finish();
         return m_shaders[name];
     }
 
+    // like loadShader, but returns while the driver is still compiling; getShader() or finishShaders() waits for it,
+    // anything else can be loaded in between
+    void submitShader(const std::string& name, const std::string& vertexShaderFile, const std::string& fragmentShaderFile,
+        const std::string& geometryShaderFile = "", const std::vector<std::string>& defines = {})
+    {
+        m_shaders[name] = addShaderSource(name, vertexShaderFile, fragmentShaderFile, geometryShaderFile, defines);
+    }
+
+    // builds the shader once for each combination, given by the names of its features, with those defined on top of
+    // defines; returns before the driver is done like submitShader()
+    void submitShaderVariants(const std::string& name, const std::string& vertexShaderFile, const std::string& fragmentShaderFile,
+        const std::vector<std::string>& features, const std::vector<std::vector<std::string>>& combinations,
+        const std::vector<std::string>& defines = {})
+    {
+        ShaderVariants variants { features };
+        for (const auto& combination : combinations) {
+            std::vector<std::string> variantDefines { defines };
+            variantDefines.insert(variantDefines.end(), combination.begin(), combination.end());
+            unsigned mask { variants.getMask(combination) };
+            variants.set(mask, addShaderSource(name + "#" + std::to_string(mask), vertexShaderFile, fragmentShaderFile, "", variantDefines));
+        }
+        m_shaderVariants[name] = variants;
+    }
+
+    void finishShaders()
+    {
+        for (auto& it : m_shaders)
+            it.second.finish();
+        for (auto& it : m_shaderVariants)
+            it.second.finish();
+    }
+
     Shader getShader(const std::string& name)
     {
-        return m_shaders[name];
+        Shader& shader { m_shaders[name] };
+        shader.finish();
+        return shader;
+    }
+
+    // shaders loaded afterwards go through the cache, nullptr compiles them every time
+    void setProgramCache(ProgramCache* cache) { m_programCache = cache; }
+
+    ShaderVariants getShaderVariants(const std::string& name)
+    {
+        ShaderVariants& variants { m_shaderVariants[name] };
+        variants.finish();
+        return variants;
     }
 
     Texture2D loadTexture(const std::string& file, bool hasAlpha, const std::string& name)
     {
         m_textures[name] = loadTextureFromFile(file, hasAlpha);
+        m_textureFiles[file] = { file, hasAlpha, name };
         return m_textures[name];
     }
 
+    // packs the images into shared atlas pages, each name then refers to its own sub-rectangle of a page
+    void loadTextureAtlas(const std::vector<TextureFile>& files)
+    {
+        TextureAtlas atlas;
+
+        for (const auto& file : files) {
+            int width, height;
+            unsigned char* data { loadAtlasImage(file, width, height) };
+            if (data == nullptr)
+                continue;
+
+            atlas.add(file.name, width, height, data);
+            stbi_image_free(data);
+            m_textureFiles[file.file] = file;
+        }
+
+        atlas.build();
+        for (const auto& it : atlas.getTextures())
+            m_textures[it.first] = it.second;
+        m_atlases.push_back(atlas);
+    }
+
     Texture2D getTexture(const std::string& name) const { return m_textures.at(name); }
 
+    // loads a changed file again, into the textures and shaders made from it; shaders are rebuilt in the background
+    // and only replace the ones in use in finishReloads(), files nothing was loaded from are ignored
+    void reload(const std::string& file)
+    {
+        // collected first, rebuilding changes their files
+        std::vector<std::string> changed;
+        for (const auto& it : m_shaderSources) {
+            if (it.second.files.count(file) > 0)
+                changed.push_back(it.first);
+        }
+        for (const auto& name : changed) {
+            // the rebuild may include other files than before, those are watched from now on
+            ShaderSource& source { m_shaderSources[name] };
+            m_reloads.push_back({ source.shader, loadShaderFromFile(source) });
+        }
+
+        auto texture { m_textureFiles.find(file) };
+        if (texture == m_textureFiles.end())
+            return;
+
+        const TextureFile& textureFile { texture->second };
+        for (auto& atlas : m_atlases) {
+            if (!atlas.contains(textureFile.name))
+                continue;
+
+            int width, height;
+            unsigned char* data { loadAtlasImage(textureFile, width, height) };
+            if (data != nullptr && !atlas.replace(textureFile.name, width, height, data))
+                std::cerr << "ERROR::TEXTURE: " << file << " changed its size, restart to pack it again" << std::endl;
+            stbi_image_free(data);
+            return;
+        }
+
+        // in the same texture object, copies of it see the new image
+        loadTextureData(m_textures[textureFile.name], file);
+    }
+
+    // swaps in the shaders reload() rebuilt once the driver is done with them, a shader that fails to build leaves the
+    // previous one in place; returns true if any was replaced
+    bool finishReloads()
+    {
+        if (m_reloads.empty())
+            return false;
+
+        bool isReplaced { false };
+        for (auto it { m_reloads.begin() }; it != m_reloads.end();) {
+            Shader& rebuilt { it->second };
+            if (!rebuilt.isReady()) {
+                ++it;
+                continue;
+            }
+
+            rebuilt.finish();
+            if (rebuilt.isLinked()) {
+                it->first.replaceProgram(rebuilt);
+                isReplaced = true;
+            } else {
+                std::cerr << "ERROR::SHADER: Keeping the previous program" << std::endl;
+                rebuilt.deleteShader();
+            }
+            it = m_reloads.erase(it);
+        }
+        return isReplaced;
+    }
+
     void clear()
     {
         for (auto& it : m_shaders)
             it.second.deleteShader();
-        for (auto& it : m_textures)
-            it.second.deleteTexture();
+        for (auto& it : m_shaderVariants)
+            it.second.deleteShaders();
+        for (auto& it : m_reloads)
+            it.second.deleteShader();
+
+        // atlas regions share their page's texture, so only delete each one once
+        std::set<GLuint> deleted;
+        for (auto& it : m_textures) {
+            if (deleted.insert(it.second.getID()).second)
+                it.second.deleteTexture();
+        }
     }
 
 private:
+    static constexpr size_t MAX_INCLUDE_DEPTH { 8 }; // stops files that include each other
+
     std::map<std::string, Shader> m_shaders;
+    std::map<std::string, ShaderVariants> m_shaderVariants;
     std::map<std::string, Texture2D> m_textures;
+    ProgramCache* m_programCache { nullptr };
+    std::map<std::string, ShaderSource> m_shaderSources; // by shader name, "name#mask" for variants
+    std::map<std::string, TextureFile> m_textureFiles; // by file
+    std::vector<TextureAtlas> m_atlases;
+    std::vector<std::pair<Shader, Shader>> m_reloads; // the shader in use and its rebuild
+
+    Shader addShaderSource(const std::string& name, const std::string& vertexShaderFile, const std::string& fragmentShaderFile,
+        const std::string& geometryShaderFile, const std::vector<std::string>& defines)
+    {
+        ShaderSource source;
+        source.vertexFile = vertexShaderFile;
+        source.fragmentFile = fragmentShaderFile;
+        source.geometryFile = geometryShaderFile;
+        source.defines = defines;
+        source.shader = loadShaderFromFile(source);
+        m_shaderSources[name] = source;
+        return source.shader;
+    }
 
-    Shader loadShaderFromFile(const std::string& vShaderFile, const std::string& fShaderFile, const std::string& gShaderFile)
+    // also collects the files read into source
+    Shader loadShaderFromFile(ShaderSource& source)
     {
         std::string vertexCode, fragmentCode, geometryCode;
+        source.files.clear();
 
         try {
-            std::ifstream vertexShaderFile { vShaderFile };
-            std::ifstream fragmentShaderFile { fShaderFile };
-            std::stringstream vertexShaderStream, fragmentShaderStream;
-
-            vertexShaderStream << vertexShaderFile.rdbuf();
-            fragmentShaderStream << fragmentShaderFile.rdbuf();
-
-            vertexShaderFile.close();
-            fragmentShaderFile.close();
-
-            vertexCode = vertexShaderStream.str();
-            fragmentCode = fragmentShaderStream.str();
-
-            if (gShaderFile != "") {
-                std::ifstream geometryShaderFile(gShaderFile);
-                std::stringstream geometryShaderStream;
-                geometryShaderStream << geometryShaderFile.rdbuf();
-                geometryShaderFile.close();
-                geometryCode = geometryShaderStream.str();
-            }
+            vertexCode = readShaderFile(source.vertexFile, source.files);
+            fragmentCode = readShaderFile(source.fragmentFile, source.files);
+            if (source.geometryFile != "")
+                geometryCode = readShaderFile(source.geometryFile, source.files);
         } catch (std::exception e) {
             std::cerr << "ERROR::SHADER::Failed to read shader files" << std::endl;
         }
 
+        const std::vector<std::string>& defines { source.defines };
         Shader shader;
-        shader.compile(vertexCode, fragmentCode, geometryCode);
+        shader.submit(addDefines(vertexCode, defines), addDefines(fragmentCode, defines), addDefines(geometryCode, defines), m_programCache);
         return shader;
     }
 
+    // replaces lines like #include "common.glsl" with that file, found next to the one including it
+    static std::string readShaderFile(const std::string& file, std::set<std::string>& files, size_t depth = 0)
+    {
+        files.insert(file);
+        std::ifstream stream { file };
+        if (!stream) {
+            std::cerr << "ERROR::SHADER: Failed to open " << file << std::endl;
+            return "";
+        }
+
+        size_t slash { file.find_last_of("/\\") };
+        std::string directory { slash == std::string::npos ? "" : file.substr(0, slash + 1) };
+
+        std::string code, line;
+        while (std::getline(stream, line)) {
+            size_t begin { line.find('"') };
+            size_t end { begin == std::string::npos ? begin : line.find('"', begin + 1) };
+            if (line.compare(0, 8, "#include") == 0 && end != std::string::npos && depth < MAX_INCLUDE_DEPTH)
+                code += readShaderFile(directory + line.substr(begin + 1, end - begin - 1), files, depth + 1);
+            else
+                code += line + "\n";
+        }
+        return code;
+    }
+
+    static std::string addDefines(const std::string& code, const std::vector<std::string>& defines)
+    {
+        if (code.empty() || defines.empty())
+            return code;
+
+        std::string lines;
+        for (const auto& define : defines)
+            lines += "#define " + define + "\n";
+
+        // #version has to stay the first line
+        size_t position { 0 };
+        if (code.compare(0, 8, "#version") == 0) {
+            position = code.find('\n');
+            position = position == std::string::npos ? code.size() : position + 1;
+        }
+        return code.substr(0, position) + lines + code.substr(position);
+    }
+
     Texture2D loadTextureFromFile(const std::string& file, bool hasAlpha)
     {
         Texture2D texture;
@@ -91,11 +303,35 @@ private:
             texture.setImageFormat(GL_RGBA);
         }
 
+        loadTextureData(texture, file);
+        return texture;
+    }
+
+    void loadTextureData(Texture2D& texture, const std::string& file)
+    {
         // laod image
         int width, height, nrChannels;
         unsigned char* data { stbi_load(file.c_str(), &width, &height, &nrChannels, 0) };
         texture.generate(width, height, data);
         stbi_image_free(data);
-        return texture;
+    }
+
+    // 4 channels, nullptr if it can't be loaded
+    static unsigned char* loadAtlasImage(const TextureFile& file, int& width, int& height)
+    {
+        int nrChannels;
+        unsigned char* data { stbi_load(file.file.c_str(), &width, &height, &nrChannels, 4) };
+
+        if (data == nullptr) {
+            std::cerr << "ERROR::TEXTURE: Failed to load " << file.file << std::endl;
+            return nullptr;
+        }
+
+        // images without alpha are drawn opaque, whatever their file says
+        if (!file.hasAlpha) {
+            for (int i { 0 }; i < width * height; ++i)
+                data[i * 4 + 3] = 255;
+        }
+        return data;
     }
 };
@@ -6,143 +6,406 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "frame_globals.hpp"
+#include "gl_extensions.hpp"
+#include "program_cache.hpp"
+#include "render_state.hpp"
 
 enum Shaders { Vertex,
     Fragment,
     Geometry,
     Program };
 
+// A resolved slot in a shader's uniform table. Looking a uniform up once and keeping the handle skips the name
+// lookup on every upload; the type parameter picks the matching glUniform* call at compile time.
+template <typename T>
+struct UniformHandle {
+    int m_slot { -1 };
+};
+
 class Shader {
 public:
-    Shader() { }
-
-    void compile(const std::string& vSource, const std::string& fSource, const std::string& gSource = "")
-    {
-        // vertex shader
-        const char* vertexSource { vSource.c_str() };
-        GLuint vertexShader { glCreateShader(GL_VERTEX_SHADER) };
-        glShaderSource(vertexShader, 1, &vertexSource, nullptr);
-        glCompileShader(vertexShader);
-        checkCompileErrors(vertexShader, Vertex);
-
-        // fragment shader
-        const char* fragmentSource { fSource.c_str() };
-        GLuint fragmentShader { glCreateShader(GL_FRAGMENT_SHADER) };
-        glShaderSource(fragmentShader, 1, &fragmentSource, nullptr);
-        glCompileShader(fragmentShader);
-        checkCompileErrors(fragmentShader, Fragment);
-
-        // geometry shader
-        GLuint geometryShader;
-        if (gSource != "") {
-            const char* geometrySource { gSource.c_str() };
-            geometryShader = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometryShader, 1, &geometrySource, nullptr);
-            checkCompileErrors(geometryShader, Geometry);
+    Shader()
+        : m_program { std::make_shared<ProgramState>() }
+    {
+    }
+
+    // with a cache the program is loaded from its binary when there is one, and saved to it when there isn't
+    void compile(const std::string& vSource, const std::string& fSource, const std::string& gSource = "", ProgramCache* cache = nullptr)
+    {
+        submit(vSource, fSource, gSource, cache);
+        finish();
+    }
+
+    // starts compiling and linking without asking for the result, which would wait for the driver, so it can work
+    // on many programs at once; finish() checks the result and has to come before the shader is used
+    void submit(const std::string& vSource, const std::string& fSource, const std::string& gSource = "", ProgramCache* cache = nullptr)
+    {
+        GLuint id { glCreateProgram() };
+        m_program->m_id = id;
+        m_program->m_cache = cache;
+        m_program->m_key = cache != nullptr ? cache->getKey({ vSource, fSource, gSource }) : 0;
+        m_program->m_isPending = true;
+
+        if (cache != nullptr) {
+            if (cache->load(m_program->m_key, id))
+                return;
+            cache->prepare(id);
         }
 
-        // shader program
-        m_id = glCreateProgram();
-        glAttachShader(m_id, vertexShader);
-        glAttachShader(m_id, fragmentShader);
+        m_program->m_stages.push_back(compileStage(GL_VERTEX_SHADER, vSource));
+        m_program->m_stages.push_back(compileStage(GL_FRAGMENT_SHADER, fSource));
         if (gSource != "")
-            glAttachShader(m_id, geometryShader);
-        glLinkProgram(m_id);
-        checkCompileErrors(m_id, Program);
+            m_program->m_stages.push_back(compileStage(GL_GEOMETRY_SHADER, gSource));
 
-        // delete the shaders
-        glDeleteShader(vertexShader);
-        glDeleteShader(fragmentShader);
-        if (gSource != "")
-            glDeleteShader(geometryShader);
+        for (GLuint stage : m_program->m_stages)
+            glAttachShader(id, stage);
+        glLinkProgram(id);
+    }
+
+    // true once finish() won't wait for the driver; only KHR_parallel_shader_compile can tell, without it a submitted
+    // shader is always ready and finishing it may wait
+    bool isReady() const
+    {
+        if (!m_program->m_isPending || !GLExtensions::get().hasParallelShaderCompile())
+            return true;
+
+        GLint isDone { GL_TRUE };
+        glGetProgramiv(m_program->m_id, GL_COMPLETION_STATUS_KHR, &isDone);
+        return isDone == GL_TRUE;
+    }
+
+    // does nothing unless the shader was submitted and not finished yet
+    void finish()
+    {
+        if (!m_program->m_isPending)
+            return;
+        m_program->m_isPending = false;
+        GLuint id { m_program->m_id };
+
+        // a program loaded from the cache has no stages and is linked already
+        if (m_program->m_stages.empty()) {
+            m_program->m_isLinked = true;
+        } else {
+            // stages are in the order of Shaders
+            for (size_t i { 0 }; i < m_program->m_stages.size(); ++i)
+                checkCompileErrors(m_program->m_stages[i], static_cast<Shaders>(i));
+            m_program->m_isLinked = checkCompileErrors(id, Program);
+            deleteStages();
+
+            if (m_program->m_cache != nullptr && m_program->m_isLinked)
+                m_program->m_cache->store(m_program->m_key, id);
+        }
+
+        reflectUniforms();
+
+        // shaders that declare the FrameGlobals block read it from the shared buffer
+        GLuint blockIndex { glGetUniformBlockIndex(id, "FrameGlobals") };
+        if (blockIndex != GL_INVALID_INDEX)
+            glUniformBlockBinding(id, blockIndex, FRAME_GLOBALS_BINDING);
     }
 
-    void use() { glUseProgram(m_id); }
+    // moves the program of a finished rebuild into the state every copy of this shader shares, so whatever holds one
+    // draws with it from then on; uniforms keep their slots, so handles stay valid, and the values set so far
+    void replaceProgram(Shader& rebuilt)
+    {
+        ProgramState& previous { *m_program };
+        ProgramState& next { *rebuilt.m_program };
+
+        // the slots of this shader first, at the same index, then the ones only the rebuild has
+        std::vector<UniformSlot> uniforms(previous.m_uniforms.size(), UniformSlot { -1, GL_NONE, {} });
+        std::unordered_map<std::string, int> slots { previous.m_slots };
+        for (const auto& it : previous.m_slots) {
+            auto found { next.m_slots.find(it.first) };
+            UniformSlot& slot { uniforms[it.second] };
+            if (found != next.m_slots.end()) {
+                slot.m_location = next.m_uniforms[found->second].m_location;
+                slot.m_type = next.m_uniforms[found->second].m_type;
+            } else {
+                slot.m_location = glGetUniformLocation(next.m_id, it.first.c_str());
+            }
+        }
+        std::unordered_map<int, int> added;
+        for (const auto& it : next.m_slots) {
+            if (slots.count(it.first) > 0)
+                continue;
+            if (added.count(it.second) == 0) {
+                added[it.second] = uniforms.size();
+                uniforms.push_back(next.m_uniforms[it.second]);
+            }
+            slots[it.first] = added[it.second];
+        }
+
+        // values set through a name the driver didn't report have no known type, they are set again by their owner
+        RenderState::get().useProgram(next.m_id);
+        for (size_t i { 0 }; i < previous.m_uniforms.size(); ++i) {
+            UniformSlot& slot { uniforms[i] };
+            if (slot.m_location < 0 || slot.m_type == GL_NONE || previous.m_uniforms[i].m_value.empty())
+                continue;
+            slot.m_value = previous.m_uniforms[i].m_value;
+            upload(slot.m_location, slot.m_type, slot.m_value);
+        }
+
+        next.m_uniforms = std::move(uniforms);
+        next.m_slots = std::move(slots);
+        std::swap(previous, next);
+        rebuilt.deleteShader();
+    }
+
+    void use() const { RenderState::get().useProgram(m_program->m_id); }
+
+    void deleteShader()
+    {
+        deleteStages();
+        m_program->m_isPending = false;
+        RenderState::get().deleteProgram(m_program->m_id);
+    }
 
-    void deleteShader() { glDeleteProgram(m_id); }
+    GLuint getID() const { return m_program->m_id; }
 
-    GLuint getID() const { return m_id; }
+    bool isLinked() const { return m_program->m_isLinked; }
 
-    void setBool(const std::string& name, bool value) const
+    template <typename T>
+    UniformHandle<T> getUniform(const std::string& name) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform1i(location, (int)value);
+        UniformHandle<T> handle;
+        handle.m_slot = findSlot(name);
+
+        if (handle.m_slot >= 0) {
+            const UniformSlot& slot { m_program->m_uniforms[handle.m_slot] };
+            if (slot.m_type != GL_NONE && !isUniformType(static_cast<const T*>(nullptr), slot.m_type))
+                std::cerr << "| WARNING::SHADER: Uniform '" << name << "' is used with the wrong type" << std::endl;
+        }
+
+        return handle;
     }
 
-    void setInt(const std::string& name, int value) const
+    // uploads only if the value differs from what this program was last given, expects the program to be in use
+    template <typename T>
+    void set(UniformHandle<T> handle, const T& value) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform1i(location, value);
+        if (handle.m_slot < 0)
+            return;
+
+        UniformSlot& slot { m_program->m_uniforms[handle.m_slot] };
+        if (slot.m_location >= 0 && hasChanged(slot, &value, sizeof(T)))
+            upload(slot.m_location, value);
     }
 
-    void setFloat(const std::string& name, float value) const
+    void setBool(const std::string& name, bool value) const { set(getUniform<int>(name), (int)value); }
+
+    void setInt(const std::string& name, int value) const { set(getUniform<int>(name), value); }
+
+    void setFloat(const std::string& name, float value) const { set(getUniform<float>(name), value); }
+
+    void setVec2(const std::string& name, const glm::vec2& value) const { set(getUniform<glm::vec2>(name), value); }
+
+    void setVec2(const std::string& name, float x, float y) const { setVec2(name, glm::vec2(x, y)); }
+
+    void setVec3(const std::string& name, const glm::vec3& value) const { set(getUniform<glm::vec3>(name), value); }
+
+    void setVec3(const std::string& name, float x, float y, float z) const { setVec3(name, glm::vec3(x, y, z)); }
+
+    void setVec4(const std::string& name, const glm::vec4& value) const { set(getUniform<glm::vec4>(name), value); }
+
+    void setVec4(const std::string& name, float x, float y, float z, float w) const { setVec4(name, glm::vec4(x, y, z, w)); }
+
+    void setMat2(const std::string& name, const glm::mat2& value) const { set(getUniform<glm::mat2>(name), value); }
+
+    void setMat3(const std::string& name, const glm::mat3& value) const { set(getUniform<glm::mat3>(name), value); }
+
+    void setMat4(const std::string& name, const glm::mat4& value) const { set(getUniform<glm::mat4>(name), value); }
+
+    void setIntArray(const std::string& name, const int* values, size_t count) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform1f(location, value);
+        int slot { findSlot(name) };
+        if (slot >= 0 && m_program->m_uniforms[slot].m_location >= 0 && hasChanged(m_program->m_uniforms[slot], values, count * sizeof(int)))
+            glUniform1iv(m_program->m_uniforms[slot].m_location, count, values);
     }
 
-    void setVec2(const std::string& name, const glm::vec2& value) const
+    void setFloatArray(const std::string& name, const float* values, size_t count) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform2fv(location, 1, glm::value_ptr(value));
+        int slot { findSlot(name) };
+        if (slot >= 0 && m_program->m_uniforms[slot].m_location >= 0 && hasChanged(m_program->m_uniforms[slot], values, count * sizeof(float)))
+            glUniform1fv(m_program->m_uniforms[slot].m_location, count, values);
     }
 
-    void setVec2(const std::string& name, float x, float y) const
+    void setVec2Array(const std::string& name, const glm::vec2* values, size_t count) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform2f(location, x, y);
+        int slot { findSlot(name) };
+        if (slot >= 0 && m_program->m_uniforms[slot].m_location >= 0 && hasChanged(m_program->m_uniforms[slot], values, count * sizeof(glm::vec2)))
+            glUniform2fv(m_program->m_uniforms[slot].m_location, count, glm::value_ptr(values[0]));
     }
 
-    void setVec3(const std::string& name, const glm::vec3& value) const
+    void setVec4Array(const std::string& name, const glm::vec4* values, size_t count) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform3fv(location, 1, glm::value_ptr(value));
+        int slot { findSlot(name) };
+        if (slot >= 0 && m_program->m_uniforms[slot].m_location >= 0 && hasChanged(m_program->m_uniforms[slot], values, count * sizeof(glm::vec4)))
+            glUniform4fv(m_program->m_uniforms[slot].m_location, count, glm::value_ptr(values[0]));
     }
 
-    void setVec3(const std::string& name, float x, float y, float z) const
+private:
+    struct UniformSlot {
+        GLint m_location;
+        GLenum m_type; // GL_NONE for names that were only found through glGetUniformLocation
+        std::vector<unsigned char> m_value; // shadow copy of the last upload
+    };
+
+    // shared between all copies of a shader, so a value set through one copy is known to all of them
+    struct ProgramState {
+        GLuint m_id { 0 };
+        bool m_isLinked { false };
+        bool m_isPending { false }; // submitted, not finished
+        std::vector<GLuint> m_stages; // of a pending program
+        ProgramCache* m_cache { nullptr };
+        uint64_t m_key { 0 };
+        std::vector<UniformSlot> m_uniforms;
+        std::unordered_map<std::string, int> m_slots;
+    };
+
+    std::shared_ptr<ProgramState> m_program;
+
+    void reflectUniforms()
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform3f(location, x, y, z);
+        m_program->m_uniforms.clear();
+        m_program->m_slots.clear();
+
+        GLint count { 0 };
+        glGetProgramiv(m_program->m_id, GL_ACTIVE_UNIFORMS, &count);
+
+        for (GLint i { 0 }; i < count; ++i) {
+            char name[256];
+            GLsizei length { 0 };
+            GLint size { 0 };
+            GLenum type { GL_NONE };
+            glGetActiveUniform(m_program->m_id, i, sizeof(name), &length, &size, &type, name);
+
+            GLint location { glGetUniformLocation(m_program->m_id, name) };
+
+            // members of uniform blocks have no location, their values live in a buffer
+            if (location < 0)
+                continue;
+
+            std::string uniformName { name, static_cast<size_t>(length) };
+            m_program->m_slots[uniformName] = m_program->m_uniforms.size();
+
+            // arrays are reported as "name[0]", make them reachable by their plain name too
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+                m_program->m_slots[uniformName.substr(0, uniformName.size() - 3)] = m_program->m_uniforms.size();
+
+            m_program->m_uniforms.push_back(UniformSlot { location, type, {} });
+        }
     }
 
-    void setVec4(const std::string& name, const glm::vec4& value) const
+    int findSlot(const std::string& name) const
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform4fv(location, 1, glm::value_ptr(value));
+        auto it { m_program->m_slots.find(name) };
+        if (it != m_program->m_slots.end())
+            return it->second;
+
+        // names like "offsets[3]" aren't in the reflected table, resolve them once and remember the result
+        int slot { static_cast<int>(m_program->m_uniforms.size()) };
+        m_program->m_uniforms.push_back(UniformSlot { glGetUniformLocation(m_program->m_id, name.c_str()), GL_NONE, {} });
+        m_program->m_slots[name] = slot;
+        return slot;
     }
 
-    void setVec4(const std::string& name, float x, float y, float z, float w) const
+    static bool hasChanged(UniformSlot& slot, const void* value, size_t size)
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniform4f(location, x, y, z, w);
+        if (slot.m_value.size() == size && std::memcmp(slot.m_value.data(), value, size) == 0)
+            return false;
+
+        slot.m_value.assign(static_cast<const unsigned char*>(value), static_cast<const unsigned char*>(value) + size);
+        return true;
     }
 
-    void setMat2(const std::string& name, const glm::mat2& value) const
+    static void upload(GLint location, int value) { glUniform1i(location, value); }
+    static void upload(GLint location, float value) { glUniform1f(location, value); }
+    static void upload(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, glm::value_ptr(value)); }
+    static void upload(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, glm::value_ptr(value)); }
+    static void upload(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, glm::value_ptr(value)); }
+    static void upload(GLint location, const glm::mat2& value) { glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+    static void upload(GLint location, const glm::mat3& value) { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+    static void upload(GLint location, const glm::mat4& value) { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+
+    // a value of any type, arrays too, as the bytes it was set with
+    static void upload(GLint location, GLenum type, const std::vector<unsigned char>& value)
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        const float* floats { reinterpret_cast<const float*>(value.data()) };
+        GLsizei count { static_cast<GLsizei>(value.size() / sizeof(float)) };
+
+        switch (type) {
+        case GL_FLOAT:
+            glUniform1fv(location, count, floats);
+            break;
+        case GL_FLOAT_VEC2:
+            glUniform2fv(location, count / 2, floats);
+            break;
+        case GL_FLOAT_VEC3:
+            glUniform3fv(location, count / 3, floats);
+            break;
+        case GL_FLOAT_VEC4:
+            glUniform4fv(location, count / 4, floats);
+            break;
+        case GL_FLOAT_MAT2:
+            glUniformMatrix2fv(location, count / 4, GL_FALSE, floats);
+            break;
+        case GL_FLOAT_MAT3:
+            glUniformMatrix3fv(location, count / 9, GL_FALSE, floats);
+            break;
+        case GL_FLOAT_MAT4:
+            glUniformMatrix4fv(location, count / 16, GL_FALSE, floats);
+            break;
+        default:
+            // ints, bools and samplers
+            glUniform1iv(location, value.size() / sizeof(int), reinterpret_cast<const int*>(value.data()));
+            break;
+        }
     }
 
-    void setMat3(const std::string& name, const glm::mat3& value) const
+    // ints also feed bools and samplers
+    static bool isUniformType(const int*, GLenum type)
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_1D || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D
+            || type == GL_SAMPLER_CUBE || type == GL_SAMPLER_2D_MULTISAMPLE || type == GL_SAMPLER_BUFFER
+            || type == GL_INT_SAMPLER_2D || type == GL_UNSIGNED_INT_SAMPLER_2D || type == GL_INT_SAMPLER_BUFFER
+            || type == GL_UNSIGNED_INT_SAMPLER_BUFFER;
     }
+    static bool isUniformType(const float*, GLenum type) { return type == GL_FLOAT; }
+    static bool isUniformType(const glm::vec2*, GLenum type) { return type == GL_FLOAT_VEC2; }
+    static bool isUniformType(const glm::vec3*, GLenum type) { return type == GL_FLOAT_VEC3; }
+    static bool isUniformType(const glm::vec4*, GLenum type) { return type == GL_FLOAT_VEC4; }
+    static bool isUniformType(const glm::mat2*, GLenum type) { return type == GL_FLOAT_MAT2; }
+    static bool isUniformType(const glm::mat3*, GLenum type) { return type == GL_FLOAT_MAT3; }
+    static bool isUniformType(const glm::mat4*, GLenum type) { return type == GL_FLOAT_MAT4; }
 
-    void setMat4(const std::string& name, const glm::mat4& value) const
+    static GLuint compileStage(GLenum type, const std::string& source)
     {
-        GLint location { glGetUniformLocation(m_id, name.c_str()) };
-        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        const char* code { source.c_str() };
+        GLuint stage { glCreateShader(type) };
+        glShaderSource(stage, 1, &code, nullptr);
+        glCompileShader(stage);
+        return stage;
     }
 
-private:
-    GLuint m_id;
+    void deleteStages()
+    {
+        for (GLuint stage : m_program->m_stages)
+            glDeleteShader(stage);
+        m_program->m_stages.clear();
+    }
 
-    void checkCompileErrors(GLuint object, Shaders type)
+    // returns true if the object compiled or linked
+    bool checkCompileErrors(GLuint object, Shaders type)
     {
         int success;
         char infoLog[1024];
@@ -166,5 +429,7 @@ private:
                           << std::endl;
             }
         }
+
+        return success;
     }
 };
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shader.hpp"
+
+// A shader built once for each of a declared set of feature combinations, every feature a #define its GLSL tests
+// with #ifdef. Drawing with a combination then takes the program specialized for it, with no branch on a uniform.
+// Variants are picked by a mask with bit i set for feature i; the base variant, mask 0, should always be built.
+class ShaderVariants {
+public:
+    ShaderVariants() { }
+
+    ShaderVariants(const std::vector<std::string>& features)
+        : m_features { features }
+    {
+    }
+
+    const std::vector<std::string>& getFeatures() const { return m_features; }
+
+    // 0 for a feature the shader doesn't have
+    unsigned getBit(const std::string& feature) const
+    {
+        for (size_t i { 0 }; i < m_features.size(); ++i) {
+            if (m_features[i] == feature)
+                return 1u << i;
+        }
+        return 0;
+    }
+
+    unsigned getMask(const std::vector<std::string>& features) const
+    {
+        unsigned mask { 0 };
+        for (const auto& feature : features) {
+            if (getBit(feature) == 0)
+                std::cerr << "ERROR::SHADERVARIANTS: No feature " << feature << std::endl;
+            mask |= getBit(feature);
+        }
+        return mask;
+    }
+
+    void set(unsigned mask, const Shader& shader) { m_variants[mask] = shader; }
+
+    bool has(unsigned mask) const { return m_variants.count(mask) > 0; }
+
+    // built and usable, a variant can fail on a driver without what its features need
+    bool isLinked(unsigned mask) const
+    {
+        auto it { m_variants.find(mask) };
+        return it != m_variants.end() && it->second.isLinked();
+    }
+
+    // a variant that is missing or failed to build gives the base one, mask 0, which draws without the features
+    Shader get(unsigned mask) const
+    {
+        auto it { m_variants.find(mask) };
+        if (it != m_variants.end() && (mask == 0 || it->second.isLinked()))
+            return it->second;
+
+        if (it == m_variants.end())
+            std::cerr << "ERROR::SHADERVARIANTS: No variant " << mask << std::endl;
+        auto base { m_variants.find(0) };
+        return base != m_variants.end() ? base->second : Shader {};
+    }
+
+    // for setting uniforms on all of them
+    const std::map<unsigned, Shader>& getVariants() const { return m_variants; }
+
+    void finish()
+    {
+        for (auto& it : m_variants)
+            it.second.finish();
+    }
+
+    void deleteShaders()
+    {
+        for (auto& it : m_variants)
+            it.second.deleteShader();
+    }
+
+private:
+    std::vector<std::string> m_features;
+    std::map<unsigned, Shader> m_variants;
+};
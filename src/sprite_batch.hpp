@@ -0,0 +1,199 @@
+#pragma once
+
+#include <deque>
+#include <stddef.h>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_state.hpp"
+#include "shader.hpp"
+#include "stream_buffer.hpp"
+#include "texture.hpp"
+#include "thread_pool.hpp"
+
+// Draws are grouped by state inside a layer (see RenderCommandBuffer), so anything that has to be drawn on top of
+// something else needs a higher layer or, if translucent, a lower depth.
+enum SpriteLayer {
+    BackgroundLayer,
+    LevelLayer,
+    ObjectLayer,
+    ParticleLayer,
+    ForegroundLayer
+};
+
+struct SpriteInstance {
+    glm::vec4 m_rect; // <vec2 position, vec2 size>
+    glm::vec4 m_uvRect; // <vec2 offset, vec2 size>
+    glm::vec4 m_color; // <vec3 color, float rotation>
+};
+
+// a sprite as it is drawn, the batch's workers turn it into a SpriteInstance
+struct SpriteDraw {
+    glm::vec2 m_position, m_size;
+    glm::vec4 m_uvRect;
+    glm::vec3 m_color;
+    float m_rotation; // in degrees
+};
+
+class SpriteBatch {
+public:
+    SpriteBatch(Shader& shader, size_t capacity = 1024)
+        : m_shader { shader }
+        , m_instanceBuffer { GL_ARRAY_BUFFER, capacity * sizeof(SpriteInstance) }
+        , m_layer { BackgroundLayer }
+        , m_drawCalls { 0 }
+        , m_threadPool { nullptr }
+    {
+        initRenderData();
+    }
+
+    ~SpriteBatch()
+    {
+        RenderState::get().deleteVertexArray(m_vertexArrayObject);
+        RenderState::get().deleteBuffer(m_quadBufferObject);
+    }
+
+    void begin()
+    {
+        m_sprites.clear();
+        m_draws.clear();
+        m_layer = BackgroundLayer;
+        m_drawCalls = 0;
+    }
+
+    void setLayer(SpriteLayer layer) { m_layer = layer; }
+
+    // builds the instances into the instance buffer on the pool's threads from now on, nullptr for the calling thread
+    // only
+    void setThreadPool(ThreadPool* pool) { m_threadPool = pool; }
+
+    void drawSprite(Texture2D& texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f), float rotation = 0.0f, glm::vec3 color = glm::vec3(1.0f))
+    {
+        // a deque, so the ones queued before stay where they are
+        m_draws.push_back(SpriteDraw { position, size, texture.getUVRect(), color, rotation });
+        drawSprite(texture.getID(), m_draws.back());
+    }
+
+    // only queues where the sprite is, it has to stay there until the next flush(); the workers build its instance
+    // from there straight into the instance buffer
+    void drawSprite(GLuint texture, const SpriteDraw& sprite) { m_sprites.push_back(QueuedSprite { m_layer, texture, &sprite }); }
+
+    // also hands the used part of the instance ring back, so call it once per frame rather than per flush
+    void end()
+    {
+        flush();
+        m_instanceBuffer.endFrame();
+    }
+
+    // sends everything queued so far in queued order, one instanced draw per run of consecutive sprites sharing a
+    // layer and texture; the command buffer's sort is what makes those runs long
+    void flush()
+    {
+        if (m_sprites.empty())
+            return;
+
+        size_t offset;
+        SpriteInstance* instances { static_cast<SpriteInstance*>(m_instanceBuffer.map(m_sprites.size() * sizeof(SpriteInstance), offset)) };
+        auto fill { [this, instances](size_t begin, size_t end) {
+            for (size_t i { begin }; i < end; ++i) {
+                const SpriteDraw& sprite { *m_sprites[i].m_sprite };
+                SpriteInstance& instance { instances[i] };
+                instance.m_rect = glm::vec4(sprite.m_position, sprite.m_size);
+                instance.m_uvRect = sprite.m_uvRect;
+                instance.m_color = glm::vec4(sprite.m_color, glm::radians(sprite.m_rotation));
+            }
+        } };
+        if (m_threadPool)
+            m_threadPool->parallelFor(m_sprites.size(), MIN_CHUNK, fill);
+        else
+            fill(0, m_sprites.size());
+        m_instanceBuffer.unmap();
+
+        RenderState& state { RenderState::get() };
+        state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.getID());
+        m_shader.use();
+        state.bindVertexArray(m_vertexArrayObject);
+
+        size_t first { 0 };
+        while (first < m_sprites.size()) {
+            size_t last { first + 1 };
+            while (last < m_sprites.size() && m_sprites[last].m_layer == m_sprites[first].m_layer && m_sprites[last].m_texture == m_sprites[first].m_texture)
+                ++last;
+
+            // there is no base instance in 3.3 core, so point the instance attributes at the start of this run instead
+            setInstanceAttributes(offset + first * sizeof(SpriteInstance));
+            state.bindTexture(0, GL_TEXTURE_2D, m_sprites[first].m_texture);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, last - first);
+            ++m_drawCalls;
+
+            first = last;
+        }
+
+        m_sprites.clear();
+        m_draws.clear();
+    }
+
+    size_t getDrawCalls() const { return m_drawCalls; }
+
+    const StreamBuffer& getInstanceBuffer() const { return m_instanceBuffer; }
+
+private:
+    // sprites per job, smaller batches aren't worth waking the workers for
+    static constexpr size_t MIN_CHUNK { 16384 };
+
+    struct QueuedSprite {
+        SpriteLayer m_layer;
+        GLuint m_texture;
+        const SpriteDraw* m_sprite;
+    };
+
+    Shader m_shader;
+    std::vector<QueuedSprite> m_sprites;
+    std::deque<SpriteDraw> m_draws; // queued by drawSprite() with a texture
+    StreamBuffer m_instanceBuffer;
+    SpriteLayer m_layer;
+    size_t m_drawCalls;
+    ThreadPool* m_threadPool;
+    GLuint m_vertexArrayObject, m_quadBufferObject;
+
+    void initRenderData()
+    {
+        float vertices[] = {
+            0, 1, 0, 1,
+            1, 0, 1, 0,
+            0, 0, 0, 0,
+
+            0, 1, 0, 1,
+            1, 1, 1, 1,
+            1, 0, 1, 0
+        };
+
+        glGenVertexArrays(1, &m_vertexArrayObject);
+        glGenBuffers(1, &m_quadBufferObject);
+
+        RenderState& state { RenderState::get() };
+        state.bindVertexArray(m_vertexArrayObject);
+
+        state.bindBuffer(GL_ARRAY_BUFFER, m_quadBufferObject);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+        state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer.getID());
+        for (GLuint attribute { 1 }; attribute <= 3; ++attribute) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+        setInstanceAttributes(0);
+    }
+
+    // expects the VAO and the instance buffer to be bound
+    void setInstanceAttributes(size_t offset)
+    {
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_rect)));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_uvRect)));
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_color)));
+    }
+};
@@ -4,6 +4,7 @@
 
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/trigonometric.hpp"
+#include "render_state.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 
@@ -15,7 +16,7 @@ public:
         initRenderData();
     }
 
-    ~SpriteRenderer() { glDeleteVertexArrays(1, &m_quadVertexArray); }
+    ~SpriteRenderer() { RenderState::get().deleteVertexArray(m_quadVertexArray); }
 
     void drawSprite(Texture2D& texture, glm::vec2 position, glm::vec2 size = glm::vec2(10.0f), float rotation = 0.0f, glm::vec3 color = glm::vec3(1.0f))
     {
@@ -29,19 +30,21 @@ public:
 
         model = glm::scale(model, glm::vec3(size, 1));
 
-        m_shader.setMat4("model", model);
-        m_shader.setVec3("spriteColor", color);
+        m_shader.set(m_modelUniform, model);
+        m_shader.set(m_colorUniform, color);
+        m_shader.set(m_uvRectUniform, texture.getUVRect());
 
-        glActiveTexture(GL_TEXTURE0);
-        texture.bind();
+        texture.bind(0);
 
-        glBindVertexArray(m_quadVertexArray);
+        RenderState::get().bindVertexArray(m_quadVertexArray);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
     }
 
 private:
     Shader m_shader;
+    UniformHandle<glm::mat4> m_modelUniform;
+    UniformHandle<glm::vec3> m_colorUniform;
+    UniformHandle<glm::vec4> m_uvRectUniform;
     GLuint m_quadVertexArray;
 
     void initRenderData()
@@ -60,13 +63,15 @@ private:
         glGenVertexArrays(1, &m_quadVertexArray);
         glGenBuffers(1, &vertexBuffer);
 
-        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        RenderState::get().bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-        glBindVertexArray(m_quadVertexArray);
+        RenderState::get().bindVertexArray(m_quadVertexArray);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+
+        m_modelUniform = m_shader.getUniform<glm::mat4>("model");
+        m_colorUniform = m_shader.getUniform<glm::vec3>("spriteColor");
+        m_uvRectUniform = m_shader.getUniform<glm::vec4>("uvRect");
     }
 };
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPRITE_VERTICES_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define SPRITE_VERTICES_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define SPRITE_VERTICES_NEON
+#include <arm_neon.h>
+#endif
+
+struct SpriteVertex {
+    float m_x, m_y, m_u, m_v;
+    uint32_t m_color; // RGBA8, red in the lowest byte
+};
+
+// Sprites as one array per field, so the kernels below can load several sprites' worth of a field at once.
+struct SpriteArrays {
+    std::vector<float> m_x, m_y, m_width, m_height;
+    std::vector<float> m_rotation; // radians, around the center
+    std::vector<float> m_u, m_v, m_uvWidth, m_uvHeight;
+    std::vector<uint32_t> m_color;
+
+    size_t size() const { return m_x.size(); }
+
+    void clear()
+    {
+        for (auto* field : { &m_x, &m_y, &m_width, &m_height, &m_rotation, &m_u, &m_v, &m_uvWidth, &m_uvHeight })
+            field->clear();
+        m_color.clear();
+    }
+
+    void push(glm::vec2 position, glm::vec2 size, float rotation, glm::vec4 uvRect, uint32_t color)
+    {
+        m_x.push_back(position.x);
+        m_y.push_back(position.y);
+        m_width.push_back(size.x);
+        m_height.push_back(size.y);
+        m_rotation.push_back(rotation);
+        m_u.push_back(uvRect.x);
+        m_v.push_back(uvRect.y);
+        m_uvWidth.push_back(uvRect.z);
+        m_uvHeight.push_back(uvRect.w);
+        m_color.push_back(color);
+    }
+};
+
+inline uint32_t packColor(glm::vec4 color)
+{
+    glm::uvec4 bytes { glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f };
+    return bytes.r | bytes.g << 8 | bytes.b << 16 | bytes.a << 24;
+}
+
+// The lane types below give the kernel the handful of operations it needs on WIDTH floats at a time. The kernel is
+// written once against them, so every instruction set computes exactly the same thing.
+
+struct ScalarLanes {
+    using Float = float;
+    using Mask = bool;
+    static constexpr size_t WIDTH { 1 };
+
+    static Float load(const float* data) { return *data; }
+    static Float set(float value) { return value; }
+    static Float add(Float a, Float b) { return a + b; }
+    static Float sub(Float a, Float b) { return a - b; }
+    static Float mul(Float a, Float b) { return a * b; }
+    static Float select(Mask mask, Float a, Float b) { return mask ? a : b; }
+    static bool isAllZero(Float value) { return value == 0.0f; }
+
+    // angle = quadrant * pi / 2 + reduced, with the sines' swap and signs for that quadrant
+    static Float reduce(Float angle, Float halfPi0, Float halfPi1, Float halfPi2, Mask& swap, Float& sinSign, Float& cosSign)
+    {
+        int quadrant { static_cast<int>(std::nearbyint(angle * 0.63661977f)) };
+        float q { static_cast<float>(quadrant) };
+        swap = quadrant & 1;
+        sinSign = 1.0f - (quadrant & 2);
+        cosSign = 1.0f - ((quadrant + 1) & 2);
+        return ((angle - q * halfPi0) - q * halfPi1) - q * halfPi2;
+    }
+
+    static void store(SpriteVertex* vertices, size_t corner, Float x, Float y, Float u, Float v, const uint32_t* colors)
+    {
+        vertices[corner] = SpriteVertex { x, y, u, v, colors[0] };
+    }
+};
+
+#ifdef SPRITE_VERTICES_SSE2
+struct Sse2Lanes {
+    using Float = __m128;
+    using Mask = __m128;
+    static constexpr size_t WIDTH { 4 };
+
+    static Float load(const float* data) { return _mm_loadu_ps(data); }
+    static Float set(float value) { return _mm_set1_ps(value); }
+    static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+    static Float select(Mask mask, Float a, Float b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    static bool isAllZero(Float value) { return _mm_movemask_ps(_mm_cmpeq_ps(value, _mm_setzero_ps())) == 0xF; }
+
+    static Float reduce(Float angle, Float halfPi0, Float halfPi1, Float halfPi2, Mask& swap, Float& sinSign, Float& cosSign)
+    {
+        __m128i quadrant { _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(0.63661977f))) };
+        __m128i one { _mm_set1_epi32(1) }, two { _mm_set1_epi32(2) };
+        Float q { _mm_cvtepi32_ps(quadrant) };
+        swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+        sinSign = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_cvtepi32_ps(_mm_and_si128(quadrant, two)));
+        cosSign = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_cvtepi32_ps(_mm_and_si128(_mm_add_epi32(quadrant, one), two)));
+        return _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(angle, _mm_mul_ps(q, halfPi0)), _mm_mul_ps(q, halfPi1)), _mm_mul_ps(q, halfPi2));
+    }
+
+    // transposes the four sprites' corner into one <x, y, u, v> register each
+    static void store(SpriteVertex* vertices, size_t corner, Float x, Float y, Float u, Float v, const uint32_t* colors)
+    {
+        _MM_TRANSPOSE4_PS(x, y, u, v);
+        Float rows[] { x, y, u, v };
+        for (size_t lane { 0 }; lane < WIDTH; ++lane) {
+            SpriteVertex& vertex { vertices[lane * 4 + corner] };
+            _mm_storeu_ps(&vertex.m_x, rows[lane]);
+            vertex.m_color = colors[lane];
+        }
+    }
+};
+#endif
+
+#ifdef SPRITE_VERTICES_AVX2
+struct Avx2Lanes {
+    using Float = __m256;
+    using Mask = __m256;
+    static constexpr size_t WIDTH { 8 };
+
+    static Float load(const float* data) { return _mm256_loadu_ps(data); }
+    static Float set(float value) { return _mm256_set1_ps(value); }
+    static Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+    static Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+    static Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+    static Float select(Mask mask, Float a, Float b) { return _mm256_blendv_ps(b, a, mask); }
+    static bool isAllZero(Float value) { return _mm256_movemask_ps(_mm256_cmp_ps(value, _mm256_setzero_ps(), _CMP_EQ_OQ)) == 0xFF; }
+
+    static Float reduce(Float angle, Float halfPi0, Float halfPi1, Float halfPi2, Mask& swap, Float& sinSign, Float& cosSign)
+    {
+        __m256i quadrant { _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(0.63661977f))) };
+        __m256i one { _mm256_set1_epi32(1) }, two { _mm256_set1_epi32(2) };
+        Float q { _mm256_cvtepi32_ps(quadrant) };
+        swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+        sinSign = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_cvtepi32_ps(_mm256_and_si256(quadrant, two)));
+        cosSign = _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two)));
+        return _mm256_sub_ps(_mm256_sub_ps(_mm256_sub_ps(angle, _mm256_mul_ps(q, halfPi0)), _mm256_mul_ps(q, halfPi1)), _mm256_mul_ps(q, halfPi2));
+    }
+
+    // transposes each 128-bit half like the SSE2 version
+    static void store(SpriteVertex* vertices, size_t corner, Float x, Float y, Float u, Float v, const uint32_t* colors)
+    {
+        for (size_t half { 0 }; half < 2; ++half) {
+            __m128 hx { half ? _mm256_extractf128_ps(x, 1) : _mm256_castps256_ps128(x) };
+            __m128 hy { half ? _mm256_extractf128_ps(y, 1) : _mm256_castps256_ps128(y) };
+            __m128 hu { half ? _mm256_extractf128_ps(u, 1) : _mm256_castps256_ps128(u) };
+            __m128 hv { half ? _mm256_extractf128_ps(v, 1) : _mm256_castps256_ps128(v) };
+            _MM_TRANSPOSE4_PS(hx, hy, hu, hv);
+            __m128 rows[] { hx, hy, hu, hv };
+            for (size_t lane { 0 }; lane < 4; ++lane) {
+                SpriteVertex& vertex { vertices[(half * 4 + lane) * 4 + corner] };
+                _mm_storeu_ps(&vertex.m_x, rows[lane]);
+                vertex.m_color = colors[half * 4 + lane];
+            }
+        }
+    }
+};
+#endif
+
+#ifdef SPRITE_VERTICES_NEON
+struct NeonLanes {
+    using Float = float32x4_t;
+    using Mask = uint32x4_t;
+    static constexpr size_t WIDTH { 4 };
+
+    static Float load(const float* data) { return vld1q_f32(data); }
+    static Float set(float value) { return vdupq_n_f32(value); }
+    static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+    static Float sub(Float a, Float b) { return vsubq_f32(a, b); }
+    static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+    static Float select(Mask mask, Float a, Float b) { return vbslq_f32(mask, a, b); }
+    static bool isAllZero(Float value) { return vminvq_u32(vceqq_f32(value, vdupq_n_f32(0.0f))) != 0; }
+
+    static Float reduce(Float angle, Float halfPi0, Float halfPi1, Float halfPi2, Mask& swap, Float& sinSign, Float& cosSign)
+    {
+        int32x4_t quadrant { vcvtnq_s32_f32(vmulq_n_f32(angle, 0.63661977f)) };
+        int32x4_t one { vdupq_n_s32(1) }, two { vdupq_n_s32(2) };
+        Float q { vcvtq_f32_s32(quadrant) };
+        swap = vceqq_s32(vandq_s32(quadrant, one), one);
+        sinSign = vsubq_f32(vdupq_n_f32(1.0f), vcvtq_f32_s32(vandq_s32(quadrant, two)));
+        cosSign = vsubq_f32(vdupq_n_f32(1.0f), vcvtq_f32_s32(vandq_s32(vaddq_s32(quadrant, one), two)));
+        return vsubq_f32(vsubq_f32(vsubq_f32(angle, vmulq_f32(q, halfPi0)), vmulq_f32(q, halfPi1)), vmulq_f32(q, halfPi2));
+    }
+
+    static void store(SpriteVertex* vertices, size_t corner, Float x, Float y, Float u, Float v, const uint32_t* colors)
+    {
+        float32x4x2_t xu { vzipq_f32(x, u) }, yv { vzipq_f32(y, v) };
+        float32x4x2_t low { vzipq_f32(xu.val[0], yv.val[0]) }, high { vzipq_f32(xu.val[1], yv.val[1]) };
+        Float rows[] { low.val[0], low.val[1], high.val[0], high.val[1] };
+        for (size_t lane { 0 }; lane < WIDTH; ++lane) {
+            SpriteVertex& vertex { vertices[lane * 4 + corner] };
+            vst1q_f32(&vertex.m_x, rows[lane]);
+            vertex.m_color = colors[lane];
+        }
+    }
+};
+#endif
+
+#if defined(SPRITE_VERTICES_AVX2)
+using DefaultLanes = Avx2Lanes;
+#elif defined(SPRITE_VERTICES_SSE2)
+using DefaultLanes = Sse2Lanes;
+#elif defined(SPRITE_VERTICES_NEON)
+using DefaultLanes = NeonLanes;
+#else
+using DefaultLanes = ScalarLanes;
+#endif
+
+// sine and cosine from minimax polynomials on [-pi/4, pi/4], accurate to a few float ulps for the angles sprites use
+template <typename Lanes>
+void sinCos(typename Lanes::Float angle, typename Lanes::Float& sine, typename Lanes::Float& cosine)
+{
+    using L = Lanes;
+    typename L::Mask swap;
+    typename L::Float sinSign, cosSign;
+    // pi / 2 in three parts, so the reduction stays exact for the first few turns
+    typename L::Float r { L::reduce(angle, L::set(1.5703125f), L::set(4.837512969970703125e-4f), L::set(7.54978995489188216e-8f), swap, sinSign, cosSign) };
+    typename L::Float r2 { L::mul(r, r) };
+
+    typename L::Float s { L::add(L::set(8.3321608736e-3f), L::mul(r2, L::set(-1.9515295891e-4f))) };
+    s = L::add(L::set(-1.6666654611e-1f), L::mul(r2, s));
+    s = L::add(r, L::mul(L::mul(r, r2), s));
+
+    typename L::Float c { L::add(L::set(-1.388731625493765e-3f), L::mul(r2, L::set(2.443315711809948e-5f))) };
+    c = L::add(L::set(4.166664568298827e-2f), L::mul(r2, c));
+    c = L::add(L::sub(L::set(1.0f), L::mul(r2, L::set(0.5f))), L::mul(L::mul(r2, r2), c));
+
+    sine = L::mul(L::select(swap, c, s), sinSign);
+    cosine = L::mul(L::select(swap, s, c), cosSign);
+}
+
+// four vertices for each of Lanes::WIDTH sprites starting at first
+template <typename Lanes>
+void buildSpriteBlock(const SpriteArrays& sprites, size_t first, SpriteVertex* vertices)
+{
+    using L = Lanes;
+    using F = typename L::Float;
+    F x { L::load(&sprites.m_x[first]) }, y { L::load(&sprites.m_y[first]) };
+    F width { L::load(&sprites.m_width[first]) }, height { L::load(&sprites.m_height[first]) };
+    F rotation { L::load(&sprites.m_rotation[first]) };
+    F cornerX[4], cornerY[4];
+
+    if (L::isAllZero(rotation)) {
+        // bricks and most other sprites, the corners are just the rectangle's
+        F right { L::add(x, width) }, bottom { L::add(y, height) };
+        cornerX[0] = x, cornerX[1] = right, cornerX[2] = right, cornerX[3] = x;
+        cornerY[0] = y, cornerY[1] = y, cornerY[2] = bottom, cornerY[3] = bottom;
+    } else {
+        F sine, cosine;
+        sinCos<L>(rotation, sine, cosine);
+
+        F halfWidth { L::mul(width, L::set(0.5f)) }, halfHeight { L::mul(height, L::set(0.5f)) };
+        F centerX { L::add(x, halfWidth) }, centerY { L::add(y, halfHeight) };
+        // rotated half extents, corners are center +- a +- b
+        F ax { L::mul(cosine, halfWidth) }, ay { L::mul(sine, halfWidth) };
+        F bx { L::mul(sine, halfHeight) }, by { L::mul(cosine, halfHeight) };
+
+        cornerX[0] = L::add(L::sub(centerX, ax), bx), cornerY[0] = L::sub(L::sub(centerY, ay), by);
+        cornerX[1] = L::add(L::add(centerX, ax), bx), cornerY[1] = L::sub(L::add(centerY, ay), by);
+        cornerX[2] = L::sub(L::add(centerX, ax), bx), cornerY[2] = L::add(L::add(centerY, ay), by);
+        cornerX[3] = L::sub(L::sub(centerX, ax), bx), cornerY[3] = L::add(L::sub(centerY, ay), by);
+    }
+
+    F u0 { L::load(&sprites.m_u[first]) }, v0 { L::load(&sprites.m_v[first]) };
+    F u1 { L::add(u0, L::load(&sprites.m_uvWidth[first])) }, v1 { L::add(v0, L::load(&sprites.m_uvHeight[first])) };
+    F cornerU[] { u0, u1, u1, u0 }, cornerV[] { v0, v0, v1, v1 };
+
+    for (size_t corner { 0 }; corner < 4; ++corner)
+        L::store(vertices, corner, cornerX[corner], cornerY[corner], cornerU[corner], cornerV[corner], &sprites.m_color[first]);
+}
+
+// Writes the transformed quads of sprites [begin, end) to vertices[begin * 4], four per sprite clockwise from the
+// top left (draw them as 0 1 2, 0 2 3). Does the same as SpriteRenderer's model matrix without building one.
+template <typename Lanes = DefaultLanes>
+void buildSpriteVertices(const SpriteArrays& sprites, SpriteVertex* vertices, size_t begin, size_t end)
+{
+    size_t i { begin };
+    for (; i + Lanes::WIDTH <= end; i += Lanes::WIDTH)
+        buildSpriteBlock<Lanes>(sprites, i, vertices + i * 4);
+    for (; i < end; ++i)
+        buildSpriteBlock<ScalarLanes>(sprites, i, vertices + i * 4);
+}
+
+template <typename Lanes = DefaultLanes>
+void buildSpriteVertices(const SpriteArrays& sprites, SpriteVertex* vertices)
+{
+    buildSpriteVertices<Lanes>(sprites, vertices, 0, sprites.size());
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stddef.h>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_state.hpp"
+#include "shader.hpp"
+#include "sprite_batch.hpp"
+
+// texture unit the hidden mask is bound to, next to the sprite texture on unit 0
+const GLuint HIDDEN_MASK_UNIT { 1 };
+
+struct StaticSpriteRun {
+    GLuint m_texture;
+    uint32_t m_first, m_count;
+};
+
+// Sprites that never move, uploaded once and drawn with one instanced call per texture. Hiding a sprite flips a
+// byte in a mask the vertex shader reads, so only that byte has to be sent again.
+class StaticSpriteBatch {
+public:
+    StaticSpriteBatch()
+        : m_dirtyBegin { 0 }
+        , m_dirtyEnd { 0 }
+    {
+        float vertices[] = {
+            0, 1, 0, 1,
+            1, 0, 1, 0,
+            0, 0, 0, 0,
+
+            0, 1, 0, 1,
+            1, 1, 1, 1,
+            1, 0, 1, 0
+        };
+
+        glGenVertexArrays(1, &m_vertexArrayObject);
+        glGenBuffers(1, &m_quadBufferObject);
+        glGenBuffers(1, &m_instanceBufferObject);
+        glGenBuffers(1, &m_maskBufferObject);
+        glGenTextures(1, &m_maskTexture);
+
+        RenderState& state { RenderState::get() };
+        state.bindVertexArray(m_vertexArrayObject);
+
+        state.bindBuffer(GL_ARRAY_BUFFER, m_quadBufferObject);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+        for (GLuint attribute { 1 }; attribute <= 3; ++attribute) {
+            glEnableVertexAttribArray(attribute);
+            glVertexAttribDivisor(attribute, 1);
+        }
+    }
+
+    StaticSpriteBatch(const StaticSpriteBatch&) = delete;
+    StaticSpriteBatch& operator=(const StaticSpriteBatch&) = delete;
+
+    ~StaticSpriteBatch()
+    {
+        RenderState& state { RenderState::get() };
+        state.deleteVertexArray(m_vertexArrayObject);
+        state.deleteBuffer(m_quadBufferObject);
+        state.deleteBuffer(m_instanceBufferObject);
+        state.deleteTexture(m_maskTexture);
+        state.deleteBuffer(m_maskBufferObject);
+    }
+
+    // replaces the contents, sprites are referred to by their index in the vector from now on
+    void build(const std::vector<std::pair<GLuint, SpriteInstance>>& sprites)
+    {
+        std::vector<size_t> order(sprites.size());
+        for (size_t i { 0 }; i < order.size(); ++i)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [&sprites](size_t a, size_t b) { return sprites[a].first < sprites[b].first; });
+
+        std::vector<SpriteInstance> instances;
+        m_slots.resize(sprites.size());
+        m_runs.clear();
+
+        for (size_t slot { 0 }; slot < order.size(); ++slot) {
+            const auto& sprite { sprites[order[slot]] };
+            m_slots[order[slot]] = slot;
+            instances.push_back(sprite.second);
+
+            if (m_runs.empty() || m_runs.back().m_texture != sprite.first)
+                m_runs.push_back(StaticSpriteRun { sprite.first, static_cast<uint32_t>(slot), 0 });
+            ++m_runs.back().m_count;
+        }
+
+        RenderState& state { RenderState::get() };
+        state.bindBuffer(GL_ARRAY_BUFFER, m_instanceBufferObject);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(SpriteInstance), instances.data(), GL_STATIC_DRAW);
+
+        // a buffer texture can't be empty
+        m_mask.assign(std::max<size_t>(sprites.size(), 1), 0);
+        state.bindBuffer(GL_TEXTURE_BUFFER, m_maskBufferObject);
+        glBufferData(GL_TEXTURE_BUFFER, m_mask.size(), m_mask.data(), GL_DYNAMIC_DRAW);
+        state.bindTexture(HIDDEN_MASK_UNIT, GL_TEXTURE_BUFFER, m_maskTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R8UI, m_maskBufferObject);
+
+        m_dirtyBegin = m_mask.size();
+        m_dirtyEnd = 0;
+    }
+
+    void setHidden(size_t index, bool isHidden)
+    {
+        size_t slot { m_slots[index] };
+        m_mask[slot] = isHidden;
+        m_dirtyBegin = std::min(m_dirtyBegin, slot);
+        m_dirtyEnd = std::max(m_dirtyEnd, slot + 1);
+    }
+
+    // the range of the mask changed since the last call, to be copied into getMaskBuffer()
+    bool takeDirtyRange(size_t& offset, size_t& size)
+    {
+        if (m_dirtyBegin >= m_dirtyEnd)
+            return false;
+
+        offset = m_dirtyBegin;
+        size = m_dirtyEnd - m_dirtyBegin;
+        m_dirtyBegin = m_mask.size();
+        m_dirtyEnd = 0;
+        return true;
+    }
+
+    const uint8_t* getMask() const { return m_mask.data(); }
+
+    GLuint getVertexArray() const { return m_vertexArrayObject; }
+
+    GLuint getInstanceBuffer() const { return m_instanceBufferObject; }
+
+    GLuint getMaskBuffer() const { return m_maskBufferObject; }
+
+    GLuint getMaskTexture() const { return m_maskTexture; }
+
+    const std::vector<StaticSpriteRun>& getRuns() const { return m_runs; }
+
+    // draws from the GL names alone, so recorded commands don't have to keep the batch itself around
+    static void draw(const Shader& shader, UniformHandle<int> firstInstance, GLuint vertexArray, GLuint instanceBuffer, GLuint maskTexture,
+        const StaticSpriteRun* runs, size_t count)
+    {
+        RenderState& state { RenderState::get() };
+        shader.use();
+        state.bindVertexArray(vertexArray);
+        state.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        state.bindTexture(HIDDEN_MASK_UNIT, GL_TEXTURE_BUFFER, maskTexture);
+
+        for (size_t i { 0 }; i < count; ++i) {
+            // without base instance every run starts at instance 0, the shader adds the run's start for the mask
+            size_t offset { runs[i].m_first * sizeof(SpriteInstance) };
+            glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_rect)));
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_uvRect)));
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(offset + offsetof(SpriteInstance, m_color)));
+            shader.set(firstInstance, static_cast<int>(runs[i].m_first));
+
+            state.bindTexture(0, GL_TEXTURE_2D, runs[i].m_texture);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6, runs[i].m_count);
+        }
+    }
+
+private:
+    GLuint m_vertexArrayObject, m_quadBufferObject, m_instanceBufferObject;
+    GLuint m_maskBufferObject, m_maskTexture;
+    std::vector<size_t> m_slots; // sprite index -> position in the instance buffer
+    std::vector<StaticSpriteRun> m_runs;
+    std::vector<uint8_t> m_mask;
+    size_t m_dirtyBegin, m_dirtyEnd;
+};
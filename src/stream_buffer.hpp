@@ -0,0 +1,212 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "gl_extensions.hpp"
+#include "render_state.hpp"
+
+enum StreamBufferMode {
+    PersistentMapping, // mapped once with ARB_buffer_storage, written in place
+    UnsynchronizedMapping, // mapped per upload with INVALIDATE_RANGE | UNSYNCHRONIZED
+    Orphaning // staged on the CPU, orphaned with glBufferData when the ring wraps
+};
+
+struct StreamBufferStats {
+    size_t m_uploaded; // bytes handed out by map()
+    size_t m_waits; // fences that weren't signalled yet when their partition came round again
+    uint64_t m_waitTime; // nanoseconds spent blocked on those fences
+};
+
+// Ring of PARTITIONS equally sized regions for data that is rewritten every frame. While the GPU reads one partition
+// the CPU fills the next; a fence guards each partition so it is only reused once the draws reading it are done.
+class StreamBuffer {
+public:
+    static constexpr size_t PARTITIONS { 3 };
+
+    StreamBuffer(GLenum target, size_t partitionSize)
+        : StreamBuffer(target, partitionSize, GLExtensions::get().hasBufferStorage() ? PersistentMapping : UnsynchronizedMapping)
+    {
+    }
+
+    StreamBuffer(GLenum target, size_t partitionSize, StreamBufferMode mode)
+        : m_target { target }
+        , m_mode { mode }
+        , m_partitionSize { align(partitionSize) }
+        , m_stats {}
+    {
+        if (m_mode == PersistentMapping && !GLExtensions::get().hasBufferStorage())
+            m_mode = UnsynchronizedMapping;
+
+        create();
+    }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    ~StreamBuffer() { destroy(); }
+
+    // returns room for size bytes, which start at offset in the buffer; write them before the next call to unmap()
+    void* map(size_t size, size_t& offset)
+    {
+        size = align(size);
+        if (size > m_partitionSize) {
+            // nothing in flight can be overwritten in fresh storage
+            destroy();
+            m_partitionSize = std::max(size, m_partitionSize * 2);
+            create();
+        } else if (m_offset + size > (m_partition + 1) * m_partitionSize) {
+            advance();
+        }
+
+        offset = m_offset;
+        m_mappedOffset = m_offset;
+        m_mappedSize = size;
+        m_offset += size;
+        m_stats.m_uploaded += size;
+
+        if (m_mode == PersistentMapping)
+            return m_mapped + offset;
+
+        if (m_mode == UnsynchronizedMapping) {
+            bind();
+            return glMapBufferRange(m_target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        }
+
+        m_staging.resize(size);
+        return m_staging.data();
+    }
+
+    void unmap()
+    {
+        // persistent mappings are coherent, there's nothing to flush
+        if (m_mode == UnsynchronizedMapping) {
+            bind();
+            glUnmapBuffer(m_target);
+        } else if (m_mode == Orphaning) {
+            bind();
+            glBufferSubData(m_target, m_mappedOffset, m_mappedSize, m_staging.data());
+        }
+    }
+
+    // call once the draws reading this frame's data have been issued
+    void endFrame() { advance(); }
+
+    GLuint getID() const { return m_bufferObject; }
+
+    StreamBufferMode getMode() const { return m_mode; }
+
+    size_t getPartitionSize() const { return m_partitionSize; }
+
+    const StreamBufferStats& getStats() const { return m_stats; }
+
+    void resetStats() { m_stats = StreamBufferStats {}; }
+
+private:
+    // keeps every upload suitably aligned for vertex attributes
+    static constexpr size_t ALIGNMENT { 16 };
+
+    GLenum m_target;
+    StreamBufferMode m_mode;
+    size_t m_partitionSize, m_partition, m_offset;
+    size_t m_mappedOffset, m_mappedSize;
+    GLuint m_bufferObject;
+    unsigned char* m_mapped;
+    GLsync m_fences[PARTITIONS];
+    std::vector<unsigned char> m_staging;
+    StreamBufferStats m_stats;
+
+    static size_t align(size_t size) { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    void bind()
+    {
+        if (m_target == GL_ARRAY_BUFFER || m_target == GL_UNIFORM_BUFFER)
+            RenderState::get().bindBuffer(m_target, m_bufferObject);
+        else
+            glBindBuffer(m_target, m_bufferObject);
+    }
+
+    void create()
+    {
+        m_partition = 0;
+        m_offset = 0;
+        m_mapped = nullptr;
+        std::fill(m_fences, m_fences + PARTITIONS, nullptr);
+
+        glGenBuffers(1, &m_bufferObject);
+        bind();
+
+        GLsizeiptr size { static_cast<GLsizeiptr>(m_partitionSize * PARTITIONS) };
+        if (m_mode == PersistentMapping) {
+            GLbitfield flags { GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+            GLExtensions::get().bufferStorage(m_target, size, nullptr, flags);
+            m_mapped = static_cast<unsigned char*>(glMapBufferRange(m_target, 0, size, flags));
+
+            if (!m_mapped) {
+                std::cerr << "ERROR::STREAM_BUFFER: Failed to map persistently, falling back to unsynchronized mapping" << std::endl;
+                destroy();
+                m_mode = UnsynchronizedMapping;
+                create();
+            }
+        } else {
+            glBufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    void destroy()
+    {
+        for (auto& fence : m_fences) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        // deleting the buffer also releases a persistent mapping
+        RenderState::get().deleteBuffer(m_bufferObject);
+    }
+
+    void advance()
+    {
+        if (m_mode != Orphaning)
+            m_fences[m_partition] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_partition = (m_partition + 1) % PARTITIONS;
+        m_offset = m_partition * m_partitionSize;
+
+        if (m_mode == Orphaning) {
+            // the driver hands out new storage and frees the old one once the GPU is done with it
+            if (m_partition == 0) {
+                bind();
+                glBufferData(m_target, m_partitionSize * PARTITIONS, nullptr, GL_STREAM_DRAW);
+            }
+        } else {
+            wait(m_fences[m_partition]);
+        }
+    }
+
+    void wait(GLsync& fence)
+    {
+        if (!fence)
+            return;
+
+        GLenum result { glClientWaitSync(fence, 0, 0) };
+        if (result == GL_TIMEOUT_EXPIRED) {
+            ++m_stats.m_waits;
+            auto start { std::chrono::steady_clock::now() };
+
+            do
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            while (result == GL_TIMEOUT_EXPIRED);
+
+            m_stats.m_waitTime += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+};
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include <stddef.h>
 
+#include "render_state.hpp"
+
 class Texture2D {
 public:
     Texture2D()
@@ -15,6 +18,7 @@ public:
         , m_wrapT { GL_REPEAT }
         , m_filterMin { GL_LINEAR }
         , m_filterMax { GL_LINEAR }
+        , m_uvRect { 0.0f, 0.0f, 1.0f, 1.0f }
     {
         glGenTextures(1, &m_id);
     }
@@ -24,34 +28,62 @@ public:
         m_width = width;
         m_height = height;
 
-        glBindTexture(GL_TEXTURE_2D, m_id);
+        RenderState::get().bindTexture(0, GL_TEXTURE_2D, m_id);
         glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, width, height, 0, m_imageFormat, GL_UNSIGNED_BYTE, data);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, m_wrapS);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, m_wrapT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_filterMin);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_filterMax);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
     }
 
     void deleteTexture()
     {
-        glDeleteTextures(1, &m_id);
+        RenderState::get().deleteTexture(m_id);
     }
 
-    void bind() const { glBindTexture(GL_TEXTURE_2D, m_id); }
+    void bind(GLuint unit = 0) const { RenderState::get().bindTexture(unit, GL_TEXTURE_2D, m_id); }
+
+    // a view of part of this texture, sharing the same GL texture
+    Texture2D subTexture(glm::vec4 uvRect) const
+    {
+        Texture2D texture { *this };
+        texture.m_uvRect = uvRect;
+        return texture;
+    }
 
     GLuint getID() const { return m_id; }
 
+    size_t getWidth() const { return m_width; }
+
+    size_t getHeight() const { return m_height; }
+
+    // <vec2 offset, vec2 size> of the region this texture covers, in texture coordinates
+    glm::vec4 getUVRect() const { return m_uvRect; }
+
+    bool hasAlpha() const { return m_internalFormat == GL_RGBA || m_internalFormat == GL_RGBA8; }
+
     void setInternalFormat(GLuint format) { m_internalFormat = format; }
 
     void setImageFormat(GLuint format) { m_imageFormat = format; }
 
+    void setWrap(GLuint wrapS, GLuint wrapT)
+    {
+        m_wrapS = wrapS;
+        m_wrapT = wrapT;
+    }
+
+    void setFilter(GLuint filterMin, GLuint filterMax)
+    {
+        m_filterMin = filterMin;
+        m_filterMax = filterMax;
+    }
+
 private:
     GLuint m_id;
     size_t m_width, m_height;
     GLuint m_internalFormat, m_imageFormat;
     GLuint m_wrapS, m_wrapT;
     GLuint m_filterMin, m_filterMax;
+    glm::vec4 m_uvRect;
 };
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "texture.hpp"
+
+// Bottom-left skyline packer: the top edge of everything placed so far is kept as a list of horizontal segments and
+// every new rectangle goes where its top ends up the lowest.
+class SkylinePacker {
+public:
+    SkylinePacker(size_t width, size_t height)
+        : m_width { width }
+        , m_height { height }
+    {
+        m_skyline.push_back(Segment { 0, 0, width });
+    }
+
+    bool insert(size_t width, size_t height, size_t& x, size_t& y)
+    {
+        size_t bestIndex { m_skyline.size() };
+        size_t bestTop { m_height + 1 };
+
+        for (size_t i { 0 }; i < m_skyline.size(); ++i) {
+            size_t top;
+            if (fits(i, width, height, top) && top + height < bestTop) {
+                bestIndex = i;
+                bestTop = top + height;
+            }
+        }
+
+        if (bestIndex == m_skyline.size())
+            return false;
+
+        x = m_skyline[bestIndex].m_x;
+        y = bestTop - height;
+        addSegment(bestIndex, Segment { x, bestTop, width });
+        return true;
+    }
+
+    // the area actually covered, pages are cropped to it once packing is done
+    size_t getUsedWidth() const
+    {
+        size_t used { 0 };
+        for (const auto& segment : m_skyline) {
+            if (segment.m_y > 0)
+                used = segment.m_x + segment.m_width;
+        }
+        return used;
+    }
+
+    size_t getUsedHeight() const
+    {
+        size_t used { 0 };
+        for (const auto& segment : m_skyline)
+            used = std::max(used, segment.m_y);
+        return used;
+    }
+
+private:
+    struct Segment {
+        size_t m_x, m_y, m_width;
+    };
+
+    size_t m_width, m_height;
+    std::vector<Segment> m_skyline;
+
+    bool fits(size_t index, size_t width, size_t height, size_t& top) const
+    {
+        size_t x { m_skyline[index].m_x };
+        if (x + width > m_width)
+            return false;
+
+        // the rectangle rests on the highest segment it spans
+        top = 0;
+        size_t remaining { width };
+        for (size_t i { index }; remaining > 0; ++i) {
+            top = std::max(top, m_skyline[i].m_y);
+            if (top + height > m_height)
+                return false;
+            remaining -= std::min(remaining, m_skyline[i].m_width);
+        }
+
+        return true;
+    }
+
+    void addSegment(size_t index, Segment segment)
+    {
+        m_skyline.insert(m_skyline.begin() + index, segment);
+
+        // shrink or remove the segments the new one now covers
+        size_t end { segment.m_x + segment.m_width };
+        for (size_t i { index + 1 }; i < m_skyline.size();) {
+            if (m_skyline[i].m_x >= end)
+                break;
+
+            size_t segmentEnd { m_skyline[i].m_x + m_skyline[i].m_width };
+            if (segmentEnd <= end) {
+                m_skyline.erase(m_skyline.begin() + i);
+            } else {
+                m_skyline[i].m_width = segmentEnd - end;
+                m_skyline[i].m_x = end;
+                break;
+            }
+        }
+
+        // merge neighbours at the same height
+        for (size_t i { 0 }; i + 1 < m_skyline.size();) {
+            if (m_skyline[i].m_y == m_skyline[i + 1].m_y) {
+                m_skyline[i].m_width += m_skyline[i + 1].m_width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+            } else {
+                ++i;
+            }
+        }
+    }
+};
+
+// Packs RGBA images into as few pages as possible. Every image gets a border of padding filled with copies of its
+// edge pixels, so linear filtering at the rim of a sub-rectangle never picks up its neighbours.
+class TextureAtlas {
+public:
+    TextureAtlas(size_t pageSize = 2048, size_t padding = 2)
+        : m_pageSize { pageSize }
+        , m_padding { padding }
+    {
+        GLint maxSize { 0 };
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        if (maxSize > 0)
+            m_pageSize = std::min(m_pageSize, static_cast<size_t>(maxSize));
+    }
+
+    // pixels are 4 channels, top row first
+    void add(const std::string& name, size_t width, size_t height, const unsigned char* pixels)
+    {
+        Image image;
+        image.m_name = name;
+        image.m_width = width;
+        image.m_height = height;
+        image.m_pixels.assign(pixels, pixels + width * height * 4);
+        m_images.push_back(image);
+    }
+
+    void build()
+    {
+        // tallest first packs a skyline tightest
+        std::vector<Image*> order;
+        for (auto& image : m_images)
+            order.push_back(&image);
+        std::stable_sort(order.begin(), order.end(), [](const Image* a, const Image* b) {
+            return a->m_height > b->m_height || (a->m_height == b->m_height && a->m_width > b->m_width);
+        });
+
+        std::vector<SkylinePacker> packers;
+        for (auto image : order) {
+            size_t cellWidth { image->m_width + 2 * m_padding };
+            size_t cellHeight { image->m_height + 2 * m_padding };
+
+            bool isPlaced { false };
+            for (size_t page { 0 }; page < packers.size() && !isPlaced; ++page) {
+                if (packers[page].insert(cellWidth, cellHeight, image->m_x, image->m_y)) {
+                    image->m_page = page;
+                    isPlaced = true;
+                }
+            }
+
+            if (!isPlaced) {
+                if (cellWidth > m_pageSize || cellHeight > m_pageSize)
+                    std::cerr << "WARNING::TEXTURE_ATLAS: " << image->m_name << " is larger than an atlas page" << std::endl;
+
+                packers.push_back(SkylinePacker { std::max(m_pageSize, cellWidth), std::max(m_pageSize, cellHeight) });
+                packers.back().insert(cellWidth, cellHeight, image->m_x, image->m_y);
+                image->m_page = packers.size() - 1;
+            }
+        }
+
+        for (size_t page { 0 }; page < packers.size(); ++page)
+            buildPage(page, packers[page].getUsedWidth(), packers[page].getUsedHeight());
+
+        m_images.clear();
+    }
+
+    bool contains(const std::string& name) const { return m_textures.count(name) > 0; }
+
+    // draws a new image over a packed one in its page, returns false if it doesn't have the same size and would need
+    // packing again
+    bool replace(const std::string& name, size_t width, size_t height, const unsigned char* pixels)
+    {
+        const Texture2D& region { m_textures.at(name) };
+        glm::vec4 uvRect { region.getUVRect() };
+        if (std::lround(uvRect.z * region.getWidth()) != static_cast<long>(width) || std::lround(uvRect.w * region.getHeight()) != static_cast<long>(height))
+            return false;
+
+        // the cell alone, as a page of its own size
+        Image image;
+        image.m_width = width;
+        image.m_height = height;
+        image.m_x = 0;
+        image.m_y = 0;
+        image.m_pixels.assign(pixels, pixels + width * height * 4);
+        size_t cellWidth { width + 2 * m_padding };
+        size_t cellHeight { height + 2 * m_padding };
+        std::vector<unsigned char> cell(cellWidth * cellHeight * 4);
+        blit(image, cell, cellWidth);
+
+        GLint x { static_cast<GLint>(std::lround(uvRect.x * region.getWidth())) - static_cast<GLint>(m_padding) };
+        GLint y { static_cast<GLint>(std::lround(uvRect.y * region.getHeight())) - static_cast<GLint>(m_padding) };
+        region.bind();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, cellWidth, cellHeight, GL_RGBA, GL_UNSIGNED_BYTE, cell.data());
+        return true;
+    }
+
+    Texture2D getTexture(const std::string& name) const { return m_textures.at(name); }
+
+    const std::map<std::string, Texture2D>& getTextures() const { return m_textures; }
+
+    const std::vector<Texture2D>& getPages() const { return m_pages; }
+
+private:
+    struct Image {
+        std::string m_name;
+        size_t m_width, m_height;
+        size_t m_x, m_y, m_page;
+        std::vector<unsigned char> m_pixels;
+    };
+
+    size_t m_pageSize, m_padding;
+    std::vector<Image> m_images;
+    std::vector<Texture2D> m_pages;
+    std::map<std::string, Texture2D> m_textures;
+
+    void buildPage(size_t page, size_t width, size_t height)
+    {
+        std::vector<unsigned char> pixels(width * height * 4, 0);
+
+        for (const auto& image : m_images) {
+            if (image.m_page == page)
+                blit(image, pixels, width);
+        }
+
+        Texture2D texture;
+        texture.setInternalFormat(GL_RGBA);
+        texture.setImageFormat(GL_RGBA);
+        texture.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        texture.generate(width, height, pixels.data());
+        m_pages.push_back(texture);
+
+        for (const auto& image : m_images) {
+            if (image.m_page == page) {
+                glm::vec4 uvRect {
+                    (image.m_x + m_padding) / static_cast<float>(width),
+                    (image.m_y + m_padding) / static_cast<float>(height),
+                    image.m_width / static_cast<float>(width),
+                    image.m_height / static_cast<float>(height)
+                };
+                m_textures[image.m_name] = texture.subTexture(uvRect);
+            }
+        }
+    }
+
+    // copies the image into its cell and extrudes the edge pixels into the padding around it
+    void blit(const Image& image, std::vector<unsigned char>& pixels, size_t pageWidth)
+    {
+        size_t cellWidth { image.m_width + 2 * m_padding };
+        size_t cellHeight { image.m_height + 2 * m_padding };
+
+        for (size_t y { 0 }; y < cellHeight; ++y) {
+            size_t sourceY { std::min(y > m_padding ? y - m_padding : 0, image.m_height - 1) };
+
+            for (size_t x { 0 }; x < cellWidth; ++x) {
+                size_t sourceX { std::min(x > m_padding ? x - m_padding : 0, image.m_width - 1) };
+                const unsigned char* source { &image.m_pixels[(sourceY * image.m_width + sourceX) * 4] };
+                unsigned char* target { &pixels[((image.m_y + y) * pageWidth + image.m_x + x) * 4] };
+                std::copy(source, source + 4, target);
+            }
+        }
+    }
+};
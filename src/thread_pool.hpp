@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// Worker threads for splitting a loop into chunks. The calling thread works on the chunks too and parallelFor()
+// only returns once all of them are done, so the loop body can write straight into memory the caller owns, like a
+// mapped buffer, and the caller can issue GL calls right after. Jobs can't start another parallelFor().
+class ThreadPool {
+public:
+    // threads counts the calling thread, so 1 runs everything on the caller
+    ThreadPool(size_t threads = std::thread::hardware_concurrency())
+        : m_count { 0 }
+        , m_chunkSize { 1 }
+        , m_next { 0 }
+        , m_active { 0 }
+        , m_generation { 0 }
+        , m_isStopping { false }
+    {
+        for (size_t i { 1 }; i < threads; ++i)
+            m_workers.emplace_back([this] { work(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock { m_mutex };
+            m_isStopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers)
+            worker.join();
+    }
+
+    size_t getThreadCount() const { return m_workers.size() + 1; }
+
+    // calls job(begin, end) for chunks covering [0, count), each at least minChunk long but the last
+    template <typename Job>
+    void parallelFor(size_t count, size_t minChunk, Job&& job)
+    {
+        if (m_workers.empty() || count <= minChunk) {
+            job(size_t { 0 }, count);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock { m_mutex };
+            m_job = [&job](size_t begin, size_t end) { job(begin, end); };
+            m_count = count;
+            // a few chunks per thread, so one that gets descheduled doesn't hold up everybody else
+            m_chunkSize = std::max(minChunk, (count + getThreadCount() * 4 - 1) / (getThreadCount() * 4));
+            m_next = 0;
+            m_active = m_workers.size();
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock { m_mutex };
+        m_done.wait(lock, [this] { return m_active == 0; });
+        m_job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake, m_done;
+    std::function<void(size_t, size_t)> m_job;
+    size_t m_count, m_chunkSize;
+    std::atomic<size_t> m_next;
+    size_t m_active; // workers still busy with the current job
+    size_t m_generation; // counts jobs, so a worker can tell a new one from the one it just finished
+    bool m_isStopping;
+
+    void runChunks()
+    {
+        for (size_t begin { m_next.fetch_add(m_chunkSize) }; begin < m_count; begin = m_next.fetch_add(m_chunkSize))
+            m_job(begin, std::min(begin + m_chunkSize, m_count));
+    }
+
+    void work()
+    {
+        size_t generation { 0 };
+        std::unique_lock<std::mutex> lock { m_mutex };
+
+        while (true) {
+            m_wake.wait(lock, [this, generation] { return m_isStopping || m_generation != generation; });
+            if (m_isStopping)
+                return;
+            generation = m_generation;
+
+            lock.unlock();
+            runChunks();
+            lock.lock();
+
+            if (--m_active == 0)
+                m_done.notify_one();
+        }
+    }
+};
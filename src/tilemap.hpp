@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_state.hpp"
+#include "shader.hpp"
+#include "texture.hpp"
+
+// tile codes index the style arrays of the tilemap shader, code 0 is empty
+const size_t MAX_TILE_CODES { 16 };
+
+// texture unit the tile codes are bound to, next to the tile texture on unit 0
+const GLuint TILE_CODES_UNIT { 1 };
+
+struct TileChange {
+    uint32_t m_column, m_row;
+    uint8_t m_code;
+};
+
+// Everything needed to draw a tilemap, by GL name and value.
+struct TilemapDraw {
+    GLuint m_vertexArray, m_tiles, m_texture;
+    glm::vec4 m_rect; // <vec2 position, vec2 size>
+    glm::vec2 m_tileCount;
+    glm::vec4 m_colors[MAX_TILE_CODES];
+    glm::vec4 m_uvRects[MAX_TILE_CODES]; // <vec2 offset, vec2 size>
+};
+
+// A grid of tile codes in an integer texture, drawn as a single quad whose fragment shader looks up the tile under
+// each pixel. The cost depends on the covered pixels only, and changing a tile is a one texel upload.
+class Tilemap {
+public:
+    Tilemap()
+        : m_draw {}
+    {
+        // the quad is generated from gl_VertexID, the vertex array only has to exist
+        glGenVertexArrays(1, &m_draw.m_vertexArray);
+
+        m_tiles.setInternalFormat(GL_R8UI);
+        m_tiles.setImageFormat(GL_RED_INTEGER);
+        m_tiles.setFilter(GL_NEAREST, GL_NEAREST);
+        m_tiles.setWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        m_draw.m_tiles = m_tiles.getID();
+    }
+
+    Tilemap(const Tilemap&) = delete;
+    Tilemap& operator=(const Tilemap&) = delete;
+
+    ~Tilemap()
+    {
+        RenderState::get().deleteVertexArray(m_draw.m_vertexArray);
+        m_tiles.deleteTexture();
+    }
+
+    // codes are row by row, top row first; all tiles are drawn from regions of the same texture
+    void build(size_t columns, size_t rows, std::vector<uint8_t> codes, GLuint texture, glm::vec4 rect)
+    {
+        // rows of an odd number of bytes aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        m_tiles.generate(columns, rows, codes.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        m_draw.m_texture = texture;
+        m_draw.m_rect = rect;
+        m_draw.m_tileCount = glm::vec2(columns, rows);
+        m_changes.clear();
+    }
+
+    void setStyle(uint8_t code, glm::vec3 color, glm::vec4 uvRect)
+    {
+        m_draw.m_colors[code] = glm::vec4(color, 1.0f);
+        m_draw.m_uvRects[code] = uvRect;
+    }
+
+    void setTile(size_t column, size_t row, uint8_t code)
+    {
+        m_changes.push_back(TileChange { static_cast<uint32_t>(column), static_cast<uint32_t>(row), code });
+    }
+
+    // tiles changed since the last call to clearChanges(), still to be sent to getTiles()
+    const std::vector<TileChange>& getChanges() const { return m_changes; }
+
+    void clearChanges() { m_changes.clear(); }
+
+    GLuint getTiles() const { return m_tiles.getID(); }
+
+    const TilemapDraw& getDraw() const { return m_draw; }
+
+    static void updateTile(GLuint tiles, const TileChange& change)
+    {
+        RenderState::get().bindTexture(TILE_CODES_UNIT, GL_TEXTURE_2D, tiles);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, change.m_column, change.m_row, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE, &change.m_code);
+    }
+
+    static void draw(const Shader& shader, UniformHandle<glm::vec4> rectUniform, UniformHandle<glm::vec2> tileCountUniform, const TilemapDraw& tilemap)
+    {
+        RenderState& state { RenderState::get() };
+        shader.use();
+        shader.set(rectUniform, tilemap.m_rect);
+        shader.set(tileCountUniform, tilemap.m_tileCount);
+        shader.setVec4Array("tileColors", tilemap.m_colors, MAX_TILE_CODES);
+        shader.setVec4Array("tileUVRects", tilemap.m_uvRects, MAX_TILE_CODES);
+
+        state.bindTexture(0, GL_TEXTURE_2D, tilemap.m_texture);
+        state.bindTexture(TILE_CODES_UNIT, GL_TEXTURE_2D, tilemap.m_tiles);
+        state.bindVertexArray(tilemap.m_vertexArray);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+private:
+    Texture2D m_tiles;
+    TilemapDraw m_draw;
+    std::vector<TileChange> m_changes;
+};